@@ -1,6 +1,7 @@
 #pragma once
 #include "Token.h"
 #include "Utility.h"
+#include "ProgramArena.h"
 
 namespace interpreter {
 
@@ -18,18 +19,22 @@ namespace interpreter {
             CALL = 1 << 5,              // myFunction(X)
         };
 
-        const std::unordered_map<TokenType, Precedence> sOperatorPrecedenceMap
+        // Infix precedence of every TokenType, indexed by the TokenType. Anything that isn't an infix operator is LOWEST.
+        constexpr std::array<Precedence, sTokenTypeCount> sOperatorPrecedences{ []()
         {
-            {TokenType::EQ,EQUALS},
-            {TokenType::NOT_EQ, EQUALS},
-            {TokenType::LT, LESSGREATER},
-            {TokenType::GT, LESSGREATER},
-            {TokenType::PLUS, SUM},
-            {TokenType::MINUS, SUM},
-            {TokenType::SLASH, PRODUCT},
-            {TokenType::ASTERISK, PRODUCT},
-            {TokenType::LPAREN, CALL},
-        };
+            std::array<Precedence, sTokenTypeCount> precedences{};
+            const auto Set = [&precedences](TokenType tokenType, Precedence precedence) { precedences[static_cast<size_t>(tokenType)] = precedence; };
+            Set(TokenType::EQ, EQUALS);
+            Set(TokenType::NOT_EQ, EQUALS);
+            Set(TokenType::LT, LESSGREATER);
+            Set(TokenType::GT, LESSGREATER);
+            Set(TokenType::PLUS, SUM);
+            Set(TokenType::MINUS, SUM);
+            Set(TokenType::SLASH, PRODUCT);
+            Set(TokenType::ASTERISK, PRODUCT);
+            Set(TokenType::LPAREN, CALL);
+            return precedences;
+        }() };
 
         enum class NodeType : uint8_t
         {
@@ -60,8 +65,10 @@ namespace interpreter {
 
         struct Node
         {
-            virtual std::optional<Token> TokenNode() = 0;
-            virtual std::string Log() = 0;
+            // Appends the source form of the node and its children to out
+            virtual void Log(OutputBuffer& out) const = 0;
+            // The same text on its own, use the buffer version when logging more than a node or two
+            std::string Log() const;
             NodeType mNodeType;
             virtual ~Node() {};
         };
@@ -70,13 +77,21 @@ namespace interpreter {
         {
             virtual std::optional<Token> StatementNode() = 0;
             virtual ~Statement() {};
+
+            const Token& TokenNode() const { return *mToken; }
+
+            const Token* mToken{ nullptr };     // Copied into the Program's arena once, nodes built from the same token share it
         };
 
         struct Expression : public Node
         {
             virtual std::optional<Token> ExpressionNode() = 0;
-            ExpressionType mExpressionType;
             virtual ~Expression() {};
+
+            const Token& TokenNode() const { return *mToken; }
+
+            ExpressionType mExpressionType;
+            const Token* mToken{ nullptr };     // Copied into the Program's arena once, nodes built from the same token share it
         };
 
         struct LetStatement final : public Statement
@@ -84,14 +99,13 @@ namespace interpreter {
             LetStatement() { mNodeType = NodeType::LetStatement; }
             virtual ~LetStatement() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> StatementNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;                       // let Token
-            ExpressionUniquePtr mIdentifier;
-            ExpressionUniquePtr mValue;         // Expression to assign 
+            // Variables, mToken is "let"
+            ExpressionPtr mIdentifier{ nullptr };
+            ExpressionPtr mValue{ nullptr };         // Expression to assign 
         };
 
         struct ReturnStatement final : public Statement
@@ -99,27 +113,25 @@ namespace interpreter {
             ReturnStatement() { mNodeType = NodeType::ReturnStatement; }
             virtual ~ReturnStatement() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> StatementNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;                       // return Token
-            ExpressionUniquePtr mValue;         // Return value expression
+            // Variables, mToken is "return"
+            ExpressionPtr mValue{ nullptr };         // Return value expression
         };
 
         struct BlockStatement final : public Statement
         {
-            BlockStatement() { mNodeType = NodeType::BlockStatement; }
+            BlockStatement(ProgramArena& arena) : mStatements(arena) { mNodeType = NodeType::BlockStatement; }
             virtual ~BlockStatement() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> StatementNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken; // the { token
-            std::vector<StatementUniquePtr> mStatements;
+            // Variables, mToken is "{"
+            ArenaVector<StatementPtr> mStatements;
         };
 
         struct ConditionBlockStatement final : public Statement
@@ -127,14 +139,13 @@ namespace interpreter {
             ConditionBlockStatement() { mNodeType = NodeType::ConditionBlockStatement; }
             virtual ~ConditionBlockStatement() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> StatementNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken; // the conditional token == "if" || "else if" || "else"
-            ExpressionUniquePtr mCondition;     // This will be empty if it's an "else"
-            BlockStatementUniquePtr mBlock;     // holds the statement 
+            // Variables, mToken is "if" || "else if"
+            ExpressionPtr mCondition{ nullptr };     // This will be empty if it's an "else"
+            BlockStatementPtr mBlock{ nullptr };     // holds the statement 
         };
 
         struct ExpressionStatement final : public Statement
@@ -142,13 +153,12 @@ namespace interpreter {
             ExpressionStatement() { mNodeType = NodeType::ExpressionStatement; }
             virtual ~ExpressionStatement() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> StatementNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;                       // The first token of the expression
-            ExpressionUniquePtr mValue;         // Rest of the expression
+            // Variables, mToken is the first token of the expression, the same Token the node that starts it points to
+            ExpressionPtr mValue{ nullptr };         // Rest of the expression
         };
 
         struct PrimitiveExpression final : public Expression
@@ -156,12 +166,12 @@ namespace interpreter {
             PrimitiveExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::PrimitiveExpression; }
             virtual ~PrimitiveExpression() {}
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
             // Variables
-            Token mToken;
+            SymbolId mSymbol{ sNoSymbol };  // Set for identifiers
         };
 
         struct PrefixExpression final : public Expression
@@ -169,14 +179,12 @@ namespace interpreter {
             PrefixExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::PrefixExpression; }
             virtual ~PrefixExpression() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;
-            Token mOperator;
-            ExpressionUniquePtr mRightSideValue;
+            // Variables, mToken is the operator
+            ExpressionPtr mRightSideValue{ nullptr };
         };
 
         struct InfixExpression final : public Expression
@@ -184,71 +192,76 @@ namespace interpreter {
             InfixExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::InfixExpression; }
             virtual ~InfixExpression() {};
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            ExpressionUniquePtr mLeftExpression;
-            Token mToken;   // The operator token, e.g. +,- etc.
-            ExpressionUniquePtr mRightExpression;
+            // Variables, mToken is the operator, e.g. +,- etc.
+            ExpressionPtr mLeftExpression{ nullptr };
+            ExpressionPtr mRightExpression{ nullptr };
         };
 
         struct IfExpression final : public Expression
         {
-            IfExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::IfExpression; }
+            IfExpression(ProgramArena& arena) : mElseIfBlocks(arena) { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::IfExpression; }
             virtual ~IfExpression() {}
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;   // if token
-            ConditionBlockStatementUniquePtr mIfConditionBlock;
-            std::vector<ConditionBlockStatementUniquePtr> mElseIfBlocks;
-            BlockStatementUniquePtr mAlternative;
+            // Variables, mToken is "if"
+            ConditionBlockStatementPtr mIfConditionBlock{ nullptr };
+            ArenaVector<ConditionBlockStatementPtr> mElseIfBlocks;
+            BlockStatementPtr mAlternative{ nullptr };
         };
 
         struct FunctionExpression final : public Expression
         {
-            FunctionExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::FunctionExpression; }
+            FunctionExpression(ProgramArena& arena) : mParameters(arena) { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::FunctionExpression; }
             virtual ~FunctionExpression() {}
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;   // fn token
-            std::vector<ExpressionUniquePtr> mParameters;
-            BlockStatementUniquePtr mBody;
+            // Variables, mToken is "fn"
+            ArenaVector<ExpressionPtr> mParameters;
+            BlockStatementPtr mBody{ nullptr };
         };
 
         struct CallExpression final : public Expression
         {
-            CallExpression() { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::CallExpression; }
+            CallExpression(ProgramArena& arena) : mArguments(arena) { mNodeType = NodeType::Expression; mExpressionType = ExpressionType::CallExpression; }
             virtual ~CallExpression() {}
 
-            virtual std::optional<Token> TokenNode() override;
             virtual std::optional<Token> ExpressionNode() override;
-            virtual std::string Log() override;
+            using Node::Log;
+            virtual void Log(OutputBuffer& out) const override;
 
-            // Variables
-            Token mToken;   // "(" token
-            ExpressionUniquePtr mFunction;  // should hold FunctionExpression
-            std::vector<ExpressionUniquePtr> mArguments;
+            // Variables, mToken is "("
+            ExpressionPtr mFunction{ nullptr };  // should hold FunctionExpression
+            ArenaVector<ExpressionPtr> mArguments;
         };
 
         struct Program final : public Node
         {
-            Program() { mNodeType = NodeType::Program; }
+            Program(ProgramArenaUniquePtr arena = nullptr);
             virtual ~Program() {};
 
-            std::optional<Token> TokenNode() override;
-            std::string Log() override;
+            using Node::Log;
+            void Log(OutputBuffer& out) const override;
+
+            // Drops the tree without touching a single node and hands back the emptied arena for the next Program
+            ProgramArenaUniquePtr RecycleArena();
 
             // Variables
-            std::vector<StatementUniquePtr> mStatements;
+            ProgramArenaUniquePtr mArena;     // Every node below mStatements lives in here
+            std::vector<ProgramArenaUniquePtr> mSplicedArenas;    // or in one of these when it was parsed on another thread
+            std::vector<StatementPtr> mStatements;
+            std::vector<uint32_t> mStatementOffsets;    // Added to the token offsets of the matching statement, empty when they already are offsets into mSource
+            SourceBufferSharedPtr mSource;    // Token literals are views into the source, keep it alive for as long as the tree is
+            SymbolTableSharedPtr mSymbols;    // Identifier SymbolIds are indices into this table
         };
     }
 }
\ No newline at end of file
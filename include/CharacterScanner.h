@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace interpreter
+{
+    namespace scanner
+    {
+        // Each kernel scans [begin, end) and returns a pointer to the first character that doesn't belong to the run.
+        struct ScannerKernels
+        {
+            const char* mName;
+            // Whitespace is ' ', '\t', '\r' and '\n'
+            const char* (*mFindWhiteSpaceEnd)(const char* begin, const char* end);
+            // Identifier characters are letters, digits and '_'
+            const char* (*mFindIdentifierEnd)(const char* begin, const char* end);
+            const char* (*mFindDigitEnd)(const char* begin, const char* end);
+            // Returns the first '\n' instead, used to build the LineTable
+            const char* (*mFindNewLine)(const char* begin, const char* end);
+        };
+
+        // The fastest kernels supported by the CPU we are running on, selected once at first use.
+        const ScannerKernels& GetKernels();
+        // Every kernel set the current CPU can run, scalar first. Used to cross check the vectorized versions.
+        const std::vector<ScannerKernels>& GetSupportedKernels();
+
+        inline const char* FindWhiteSpaceEnd(const char* begin, const char* end)
+        {
+            return GetKernels().mFindWhiteSpaceEnd(begin, end);
+        }
+
+        inline const char* FindIdentifierEnd(const char* begin, const char* end)
+        {
+            return GetKernels().mFindIdentifierEnd(begin, end);
+        }
+
+        inline const char* FindDigitEnd(const char* begin, const char* end)
+        {
+            return GetKernels().mFindDigitEnd(begin, end);
+        }
+
+        inline const char* FindNewLine(const char* begin, const char* end)
+        {
+            return GetKernels().mFindNewLine(begin, end);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "ForwardDeclares.h"
+#include "AbstractSyntaxTree.h"
+
+namespace interpreter
+{
+    namespace ast
+    {
+        // Rewrites a Program in place before it runs: arithmetic over literals is replaced by its result and if/else branches
+        // whose condition folds to a constant are dropped. Only what evaluates to the same value at run time is folded, an
+        // overflow or a division by zero stays in the tree for the evaluator to run into. New nodes go into the Program's arena.
+        class ConstantFolder
+        {
+        public:
+            // Bump whenever a change to folding gives a different tree for the same Program, stored programs folded by another
+            // version are parsed again instead of being run (see ProgramCache)
+            static constexpr uint64_t sVersion{ 1 };
+
+            explicit ConstantFolder(Program& program);
+
+            void Fold();
+
+            size_t FoldedExpressions() const { return mFoldedExpressions; }
+            // Condition blocks and else blocks that can never run, dropped from their if
+            size_t PrunedBranches() const { return mPrunedBranches; }
+
+        private:
+            void FoldStatement(StatementPtr statement);
+            ExpressionPtr FoldExpression(ExpressionPtr expression);
+            ExpressionPtr FoldOperators(ExpressionPtr root);
+            // The operands are folded by the time these run
+            ExpressionPtr FoldPrefixExpression(PrefixExpression* prefixExpression);
+            ExpressionPtr FoldInfixExpression(InfixExpression* infixExpression);
+            void PruneIfExpression(IfExpression* ifExpression);
+
+            // Literal spanning [begin, end) of the source
+            ExpressionPtr CreateInteger(Number value, const Token& begin, const Token& end);
+            ExpressionPtr CreateBoolean(bool value, const Token& begin, const Token& end);
+            // The parser drops parentheses, so the tokens at both ends of a span can leave out some that belong to it
+            void AssignSpan(Token& token, const Token& begin, const Token& end) const;
+
+            Program& mProgram;
+            uint32_t mStatementOffset;  // Of the top level statement being folded, see Program::mStatementOffsets
+            size_t mFoldedExpressions;
+            size_t mPrunedBranches;
+        };
+    }
+}
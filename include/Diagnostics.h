@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "ForwardDeclares.h"
+#include "Token.h"
+
+namespace interpreter
+{
+    enum class DiagnosticCode : uint8_t
+    {
+        UNEXPECTED_TOKEN,           // ExpectNextTokenIs didn't get the token it wanted
+        NO_PREFIX_PARSE_FUNCTION,   // The token can't start an expression
+    };
+
+    // One parse error. Only what's needed to describe it later, the text is built by Diagnostics::Format on request.
+    struct Diagnostic
+    {
+        DiagnosticCode mCode;
+        TokenType mExpected;    // UNEXPECTED_TOKEN only
+        TokenType mActual;      // Type of the offending token
+        uint32_t mTokenIndex;   // Position of the offending token in the token stream
+        uint32_t mOffset;       // and its span in the source
+        uint32_t mLength;
+    };
+
+    // Collects the Parser's errors. Nothing gets formatted or printed while parsing, callers that want text ask for it.
+    class Diagnostics
+    {
+    public:
+        void Report(DiagnosticCode code, const Token& token, uint32_t tokenIndex, TokenType expected = TokenType::ILLEGAL);
+        void Report(const Diagnostic& diagnostic) { mDiagnostics.push_back(diagnostic); }
+        void Append(const Diagnostics& other) { mDiagnostics.insert(mDiagnostics.end(), other.mDiagnostics.begin(), other.mDiagnostics.end()); }
+        void Clear() { mDiagnostics.clear(); }
+
+        size_t Count() const { return mDiagnostics.size(); }
+        bool Empty() const { return mDiagnostics.empty(); }
+        const std::vector<Diagnostic>& GetDiagnostics() const { return mDiagnostics; }
+
+        static std::string Format(const Diagnostic& diagnostic, const SourceBuffer& source);
+        // Formats every diagnostic and sends it to the Logger as an error
+        void Log(const SourceBuffer& source) const;
+
+    private:
+        std::vector<Diagnostic> mDiagnostics;
+    };
+}
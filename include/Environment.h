@@ -0,0 +1,31 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Variables of one scope, keyed by the Evaluator's SymbolIds. The outermost scope indexes its values by SymbolId, scopes
+    // of function calls only hold a handful of parameters and lets and search them linearly before asking the scope they
+    // were created in.
+    class Environment
+    {
+    public:
+        explicit Environment(EnvironmentSharedPtr outer = nullptr);
+
+        // Value bound to symbol in this scope or an enclosing one, nullptr when it's unbound
+        ObjectSharedPtr Get(SymbolId symbol) const;
+        // Binds symbol in this scope, shadowing a binding of an enclosing one
+        void Set(SymbolId symbol, ObjectSharedPtr value);
+        // Drops every binding of this scope. Functions hold on to the scope they were made in, so a function bound in
+        // its own scope keeps both alive until the scope is cleared.
+        void Clear();
+        // True when scope is this one or one of the scopes enclosing it
+        bool IsWithin(const Environment& scope) const;
+
+    private:
+        EnvironmentSharedPtr mOuter;
+        std::vector<ObjectSharedPtr> mValues;   // Outermost scope, indexed by SymbolId
+        std::vector<std::pair<SymbolId, ObjectSharedPtr>> mBindings;    // Enclosed scopes
+    };
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <deque>
+#include <span>
+#include <string>
+#include <vector>
+#include "ForwardDeclares.h"
+#include "AbstractSyntaxTree.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+namespace interpreter
+{
+    // Walks a Program and computes its values. Nodes are told apart by mNodeType and mExpressionType and static_cast to
+    // their type, debug builds check the casts. Variables live in Environments keyed by SymbolId; the SymbolIds of every
+    // Program are mapped onto the Evaluator's own table, so programs lexed one after another (lines of the REPL) see each
+    // other's lets. Function values point into the tree that defined them, that Program has to outlive them.
+    class Evaluator
+    {
+    public:
+        Evaluator();
+        ~Evaluator();
+
+        // Runs the top level statements in order, one value per statement, nullptr for a let. A top level return stops the
+        // program, its value is the last one.
+        std::vector<ObjectSharedPtr> Evaluate(const ast::Program& program);
+        // Evaluates every top level statement in a single forward scan over the nodes, one result per statement. Flat programs
+        // are only evaluated as far as expressions over literals go.
+        std::vector<ObjectSharedPtr> Evaluate(const ast::FlatProgram& program);
+
+        // Function values made so far, each one keeps the tree of its Program in use
+        size_t FunctionCount() const { return mFunctionCount; }
+
+        // false, null and 0 are falsy, everything else is truthy
+        static bool IsTruthy(const ObjectSharedPtr& value);
+        static ObjectSharedPtr GetNativeBoolObject(bool value);
+        static ObjectSharedPtr GetNativeNullObject();
+        static ObjectSharedPtr EvaluatePrefixExpression(TokenType operatorToken, const ObjectSharedPtr& right);
+        static ObjectSharedPtr EvaluateInfixExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right);
+
+    private:
+        // Statements, nullptr when the statement has no value
+        ObjectSharedPtr EvaluateStatement(const ast::Statement* statement);
+        ObjectSharedPtr EvaluateLetStatement(const ast::LetStatement* letStatement);
+        ObjectSharedPtr EvaluateReturnStatement(const ast::ReturnStatement* returnStatement);
+        // A return inside the block comes back still wrapped, so the blocks around it stop as well
+        ObjectSharedPtr EvaluateBlockStatement(const ast::BlockStatement* blockStatement);
+        // Expressions, never nullptr
+        ObjectSharedPtr EvaluateExpression(const ast::Expression* expression);
+        ObjectSharedPtr EvaluateIdentifierExpression(const ast::PrimitiveExpression* identifier);
+        ObjectSharedPtr EvaluateIfExpression(const ast::IfExpression* ifExpression);
+        ObjectSharedPtr EvaluateFunctionExpression(const ast::FunctionExpression* functionExpression);
+        // Prefix, infix and call expressions, their operands go through mPendingExpressions instead of the call stack
+        ObjectSharedPtr EvaluateOperators(const ast::Expression* root);
+        void ScheduleOperand(const ast::Expression* operand);
+        ObjectSharedPtr PopOperand();
+        // Runs the body of function in a new scope, one argument per parameter. The arguments are moved into it.
+        ObjectSharedPtr CallFunction(const FunctionType* function, std::span<ObjectSharedPtr> arguments);
+
+        static ObjectSharedPtr EvaluatePrefixBangOperatorExpression(const ObjectSharedPtr& right);
+        static ObjectSharedPtr EvaluatePrefixMinusOperatorExpression(const ObjectSharedPtr& right);
+        static ObjectSharedPtr EvaluateInfixIntegerExpression(TokenType operatorToken, Number left, Number right);
+        static ObjectSharedPtr EvaluateInfixBoolExpression(TokenType operatorToken, bool left, bool right);
+
+        // The Evaluator's SymbolId for a SymbolId of the Program being evaluated
+        SymbolId MapSymbol(SymbolId symbol) const;
+        SymbolRemapSharedPtr MapSymbols(const SymbolTableSharedPtr& symbols);
+
+        SymbolTable mSymbols;
+        std::deque<std::string> mSymbolSpellings;   // mSymbols only holds views, these are what they look at
+        EnvironmentSharedPtr mGlobals;
+        EnvironmentSharedPtr mEnvironment;  // Scope of the statement being evaluated, mGlobals outside of calls
+        SymbolRemapSharedPtr mSymbolRemap;  // Of the Program the node being evaluated belongs to
+        size_t mFunctionCount;
+        std::vector<EnvironmentWeakPtr> mClosedOverScopes;   // Call scopes left intact for a closure returned out of them
+
+        struct PendingExpression
+        {
+            const ast::Expression* mExpression;
+            uint32_t mStage;                // How far along its operands it is, see EvaluateOperators
+        };
+        std::vector<PendingExpression> mPendingExpressions;
+        std::vector<ObjectSharedPtr> mOperands;     // Values of the operands evaluated so far
+    };
+}
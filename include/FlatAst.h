@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "ForwardDeclares.h"
+#include "Token.h"
+
+namespace interpreter
+{
+    namespace ast
+    {
+        typedef uint32_t NodeIndex;
+        constexpr NodeIndex sNoNode{ UINT32_MAX };   // Stands in for a missing child, e.g. an if without an else
+
+        enum class FlatNodeKind : uint8_t
+        {
+            LetStatement,               // children: identifier, value
+            ReturnStatement,            // children: value
+            ExpressionStatement,        // children: value
+            BlockStatement,             // children: statements
+            ConditionBlockStatement,    // children: condition, block
+            IdentifierExpression,       // leaf, payload: SymbolId
+            IntegerExpression,          // leaf, payload: index into the number table
+            BooleanExpression,          // leaf, payload: 0 or 1
+            PrefixExpression,           // children: right side value, the token is the operator
+            InfixExpression,            // children: left, right, the token is the operator
+            IfExpression,               // children: if block, else if blocks..., alternative
+            FunctionExpression,         // children: body, parameters...
+            CallExpression,             // children: function, arguments...
+        };
+
+        struct FlatNode
+        {
+            FlatNodeKind mKind;
+            TokenType mTokenType;
+            uint32_t mOffset;       // Token span in the source
+            uint32_t mLength;
+            uint32_t mChildCount;
+            uint32_t mPayload;      // First child in the child table, leaves keep their literal here instead
+        };
+        static_assert(sizeof(FlatNode) == 20, "FlatNode should stay small, it's what the walks stream through");
+
+        // Flat copy of a Program: one contiguous node array addressed by 32-bit indices, children in a side table.
+        // Nodes are stored in post-order, every child comes before its parent, so a pass that needs the results of
+        // the children (logging, evaluation, analysis) is a single forward scan over mNodes instead of a pointer chase.
+        class FlatProgram
+        {
+        public:
+            static FlatProgram FromProgram(const Program& program);
+            // Reads back what Serialize wrote. source has to hold the text the program was parsed from and treeVersion has to be
+            // the one it was written with, nothing is returned when they don't or the bytes are damaged.
+            static std::optional<FlatProgram> Deserialize(std::string_view bytes, SourceBufferSharedPtr source, uint64_t treeVersion = 0);
+
+            // Compact binary form, see ProgramCache: varint encoded kinds, token offsets and child links plus the number and
+            // symbol pools. Tokens and symbols point back into the source the same way they do here, the source text is stored
+            // once so a load can check it's reading the program of that exact text. treeVersion tells trees rewritten under
+            // different rules apart, see ConstantFolder::sVersion.
+            std::string Serialize(uint64_t treeVersion = 0) const;
+            // Builds the pointer tree again in a fresh arena, same Log and evaluation results as the Program it came from
+            ProgramUniquePtr ToProgram() const;
+
+            size_t NodeCount() const { return mNodes.size(); }
+            const std::vector<FlatNode>& GetNodes() const { return mNodes; }
+            const FlatNode& GetNode(NodeIndex node) const { return mNodes[node]; }
+            std::span<const NodeIndex> GetChildren(NodeIndex node) const;
+            // Roots of the top level statements, in source order
+            const std::vector<NodeIndex>& GetStatements() const { return mStatements; }
+
+            // Source text of the node's token, a merged else if always reads "else if"
+            std::string_view Text(NodeIndex node) const;
+            Number GetNumber(NodeIndex node) const;
+            bool GetBool(NodeIndex node) const;
+            SymbolId GetSymbol(NodeIndex node) const;
+            // Rebuilds the full Token of the node
+            Token GetToken(NodeIndex node) const;
+
+            // Same output as Program::Log
+            std::string Log() const;
+
+            // Bytes held by the node, child and number tables
+            size_t MemoryUsage() const;
+
+            const SourceBufferSharedPtr& GetSource() const { return mSource; }
+            const SymbolTableSharedPtr& GetSymbols() const { return mSymbols; }
+
+        private:
+            NodeIndex Convert(const Node* node);
+            NodeIndex ConvertOperators(const Expression* root);
+            NodeIndex AddNode(FlatNodeKind kind, const Token& token, std::span<const NodeIndex> children);
+            NodeIndex AddLeaf(FlatNodeKind kind, const Token& token, uint32_t payload);
+            void AppendTokenText(std::string& out, NodeIndex node) const;
+
+            std::vector<FlatNode> mNodes;
+            std::vector<NodeIndex> mChildren;
+            std::vector<Number> mNumbers;
+            std::vector<NodeIndex> mStatements;
+            SourceBufferSharedPtr mSource;
+            SymbolTableSharedPtr mSymbols;
+        };
+    }
+}
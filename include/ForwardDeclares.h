@@ -3,6 +3,8 @@
 #include <memory>
 #include <variant>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace interpreter
 {
@@ -11,9 +13,19 @@ namespace interpreter
     class Token;
     class Message;
     class Object;
+    struct FunctionType;
+    class SourceBuffer;
+    class SymbolTable;
+    class LineTable;
+    class ProgramArena;
+    class OutputBuffer;
+    enum class ObjectType : uint8_t;
+    class Environment;
+    class Evaluator;
 
     namespace ast
     {
+        class Node;
         class Expression;
         class Statement;
         class LetStatement;
@@ -25,30 +37,38 @@ namespace interpreter
         class PrimitiveExpression;
         class InfixExpression;
         class IfExpression;
+        class FunctionExpression;
         class Program;
+        class FlatProgram;
     }
 
-    typedef int16_t CharacterRange;
     typedef uint64_t UnsignedNumber;
     typedef int64_t Number;
-    typedef std::variant<std::monostate, std::string, Number, bool> TokenPrimitive;
-    typedef std::string ObjectType;
+    typedef uint32_t SymbolId;
+    constexpr SymbolId sNoSymbol{ UINT32_MAX };
+    typedef std::variant<std::monostate, std::string_view, Number, bool> TokenPrimitive;   // string_view points into the lexer's source
 
-    typedef std::unique_ptr<ast::Expression> ExpressionUniquePtr;
-    typedef std::unique_ptr<ast::Statement> StatementUniquePtr;
-    typedef std::unique_ptr<ast::LetStatement> LetStatementUniquePtr;
-    typedef std::unique_ptr<ast::ReturnStatement> ReturnStatementUniquePtr;
-    typedef std::unique_ptr<ast::ExpressionStatement> ExpressionStatementUniquePtr;
-    typedef std::unique_ptr<ast::BlockStatement> BlockStatementUniquePtr;
-    typedef std::unique_ptr<ast::ConditionBlockStatement> ConditionBlockStatementUniquePtr;
-    typedef std::unique_ptr<ast::Expression> ExpressionUniquePtr;
-    typedef std::unique_ptr<ast::PrimitiveExpression> PrimitiveExpressionUniquePtr;
-    typedef std::unique_ptr<ast::InfixExpression> InfixExpressionUniquePtr;
-    typedef std::unique_ptr<ast::IfExpression> IfExpressionUniquePtr;
+    // AST nodes live in their Program's ProgramArena, links between them are plain pointers into it
+    typedef ast::Expression* ExpressionPtr;
+    typedef ast::Statement* StatementPtr;
+    typedef ast::LetStatement* LetStatementPtr;
+    typedef ast::ReturnStatement* ReturnStatementPtr;
+    typedef ast::ExpressionStatement* ExpressionStatementPtr;
+    typedef ast::BlockStatement* BlockStatementPtr;
+    typedef ast::ConditionBlockStatement* ConditionBlockStatementPtr;
+    typedef ast::PrimitiveExpression* PrimitiveExpressionPtr;
+    typedef ast::InfixExpression* InfixExpressionPtr;
+    typedef ast::IfExpression* IfExpressionPtr;
     typedef std::unique_ptr<ast::Program> ProgramUniquePtr;
+    typedef std::unique_ptr<ProgramArena> ProgramArenaUniquePtr;
     typedef std::unique_ptr<Object> ObjectUniquePtr;
     typedef std::shared_ptr<Object> ObjectSharedPtr;
+    typedef std::shared_ptr<Environment> EnvironmentSharedPtr;
+    typedef std::weak_ptr<Environment> EnvironmentWeakPtr;
+    typedef std::shared_ptr<const std::vector<SymbolId>> SymbolRemapSharedPtr;   // SymbolIds of a Program mapped onto another SymbolTable
 
+    typedef std::shared_ptr<const SourceBuffer> SourceBufferSharedPtr;
+    typedef std::shared_ptr<SymbolTable> SymbolTableSharedPtr;
     typedef std::unique_ptr<Lexer> LexerUniquePtr;
     typedef std::unique_ptr<Parser> ParserUniquePtr;
 
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "ForwardDeclares.h"
+#include "Diagnostics.h"
+
+namespace interpreter
+{
+    // Keeps a Program in sync with a source that is edited in place, the way an editor would drive it.
+    // The source is cut into ranges of top level statements, each ending on the ";" of a statement the Parser closed there.
+    // An edit relexes and reparses only the ranges it touches, every other range keeps its statements as they are.
+    class IncrementalParser    // Friend of Lexer
+    {
+    public:
+        explicit IncrementalParser(SourceBufferSharedPtr source);
+
+        // Replaces removedLength bytes at offset with insertedText
+        void Edit(size_t offset, size_t removedLength, std::string_view insertedText);
+
+        // The tree for the current source, valid until the next edit. Tokens keep the offsets they got in the region they were
+        // lexed in, mStatementOffsets moves them into place. Gathering it after an edit costs a pointer and an offset per statement.
+        ast::Program& GetProgram();
+        // Same errors the Parser reports for the current source
+        Diagnostics GetDiagnostics() const;
+        // Edits go into a plain string, the buffer is only made from it when somebody asks for it
+        const SourceBufferSharedPtr& GetSource();
+
+        size_t RangeCount() const { return mRanges.size(); }
+        // Ranges relexed and reparsed by the last edit
+        size_t LastReparsedRanges() const { return mLastReparsedRanges; }
+
+    private:
+        struct StatementRange
+        {
+            uint32_t mBegin;            // Span of the tokens in the source, up to and including the closing ";". Off by mShift from mShiftFrom on.
+            uint32_t mEnd;
+            uint32_t mTokenCount;
+            uint32_t mTextOffset;       // Where mBegin is in mText, the token offsets of mStatements are offsets into mText
+            bool mTerminated;           // Only the last range can run to the end of the source without a ";"
+            SourceBufferSharedPtr mText;    // What the token literals of mStatements are views into, shared by a reparsed region
+            std::vector<StatementPtr> mStatements;
+            std::vector<Diagnostic> mDiagnostics;  // Offsets and token indices relative to the start of the range
+        };
+
+        // Lexes and parses [begin, end) of the source into arena, begin has to be the start of a statement. Returns nothing when
+        // the last statement doesn't end on the region's last ";" and allowUnterminated is false, the caller takes in more.
+        std::optional<std::vector<StatementRange>> ParseRegion(uint32_t begin, uint32_t end, bool allowUnterminated, ProgramArenaUniquePtr& arena);
+        // Full parse of the current source, drops the memory kept for previous edits
+        void Rebuild();
+        uint32_t RangeBegin(size_t range) const { return mRanges[range].mBegin + (range >= mShiftFrom ? mShift : 0); }
+        uint32_t RangeEnd(size_t range) const { return mRanges[range].mEnd + (range >= mShiftFrom ? mShift : 0); }
+        // Moves where mShift starts to apply, the ranges in between get it written into them (or taken back out)
+        void MoveShift(size_t shiftFrom);
+
+        std::string mText;
+        SourceBufferSharedPtr mSource;      // Made from mText, nullptr after an edit until GetSource
+        SymbolTableSharedPtr mSymbols;
+        std::deque<std::string> mSymbolSpellings;   // mSymbols only holds views, these are what they look at
+        ProgramUniquePtr mProgram;          // Its arena holds the ranges of the last full parse
+        ProgramArenaUniquePtr mEditArena;   // Ranges reparsed since then
+        std::vector<StatementRange> mRanges;
+        // What an edit moves is everything after it. That's only written into the ranges between it and the next edit, so typing
+        // in one place doesn't walk the ranges behind it on every keystroke. Same idea as the gap of a gap buffer.
+        size_t mShiftFrom;
+        int32_t mShift;
+        size_t mLastReparsedRanges;
+        bool mStatementsChanged;            // mProgram->mStatements has to be gathered again
+    };
+}
@@ -6,44 +6,71 @@
 #include <iostream>
 
 #include "ForwardDeclares.h"
+#include "TokenStream.h"
 
 namespace interpreter 
 {
-    class Token;
     class Parser;
+    class IncrementalParser;
+
+    enum class LexerMode : uint8_t
+    {
+        TOKENIZE,   // Tokenizes the whole input up front into mTokens
+        STREAM,     // Tokens are produced on demand, the Parser pulls them one by one
+        PARALLEL,   // Like TOKENIZE, large inputs are split at newlines and the chunks are lexed on several threads
+    };
 
     class Lexer
     {
     public:
         friend Parser;
-        Lexer(std::string_view);
+        friend IncrementalParser;
+        // Inputs smaller than two chunks are lexed sequentially in LexerMode::PARALLEL
+        static constexpr size_t sDefaultChunkSize{ 1 << 20 };
+        // Source bytes per token the token arrays are reserved for up front
+        static constexpr size_t sEstimatedBytesPerToken{ 5 };
 
-        const std::vector<Token>& GetTokens();
-        std::vector<Token> GetTokenCopies() { return mTokens; };
+        // Borrows the source, tokens point straight into it
+        Lexer(SourceBufferSharedPtr source, LexerMode mode = LexerMode::TOKENIZE, size_t chunkSize = sDefaultChunkSize);
+        // Copies the input into a heap backed SourceBuffer
+        Lexer(std::string_view input, LexerMode mode = LexerMode::TOKENIZE);
+
+        // Only populated in LexerMode::TOKENIZE and LexerMode::PARALLEL
+        const TokenStream& GetTokens() const { return mTokens; }
+        std::vector<Token> GetTokenCopies() const { return { mTokens.begin(), mTokens.end() }; }
+        // Token literals are views into this buffer, anything holding on to tokens has to hold on to the source as well.
+        const SourceBufferSharedPtr& GetSource() const { return mSource; }
+        LexerMode GetMode() const { return mMode; }
+        // Identifiers are interned while lexing, every IDENT token carries its SymbolId
+        const SymbolTableSharedPtr& GetSymbols() const { return mSymbols; }
 
     private:
+        // Lexes [begin, end) of the source, used for the chunks of LexerMode::PARALLEL
+        Lexer(SourceBufferSharedPtr source, LexerMode mode, const char* begin, const char* end);
+
         Token AdvanceToken();
 
-        void AdvanceCharacter(bool hadNewLine = false);
-        const char PeekCharacter();
+        void AdvanceCharacter();
+        std::string_view CurrentCharacters(size_t count = 1) const;
         void SkipWhiteSpace();
         std::string_view ReadIdentifier();
         std::string_view ReadNumber();
-
-        std::string_view CheckElseIf();
+        void ReadOperator(Token& token, uint8_t state);
 
         void Tokenize();
-        CharacterRange* SetCharacterRange(CharacterRange range = 0);
+        void TokenizeParallel(size_t chunkSize);
+        std::vector<const char*> FindChunkBoundaries(size_t chunkCount) const;
+        void SetTokenSpan(Token& token, std::string_view text) const;
 
-        std::string mInput;
-        std::string::const_iterator mPosition;
-        std::string::const_iterator mReadPosition;
+        SourceBufferSharedPtr mSource;
+        LexerMode mMode;
+        SymbolTableSharedPtr mSymbols;
+        const char* mPosition;
+        const char* mReadPosition;
+        const char* mEnd;
         char mChar;
-        int32_t mLineNumber;
-        CharacterRange mCharacterNumber;
-        CharacterRange mCharacterRange[2];
 
-        std::vector<Token> mTokens;
+        TokenStream mTokens;
     };
 }
 
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <string_view>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Zero based line and byte column of a source offset
+    struct SourceLocation
+    {
+        uint32_t mLine;
+        uint32_t mColumn;
+    };
+
+    // Start offset of every line in a source. Tokens only carry byte offsets, this is built the first time a diagnostic
+    // needs a line and column, see SourceBuffer::GetLineTable.
+    class LineTable
+    {
+    public:
+        explicit LineTable(std::string_view source);
+
+        SourceLocation Locate(uint32_t offset) const;
+        size_t LineCount() const { return mLineStarts.size(); }
+
+    private:
+        std::vector<uint32_t> mLineStarts;
+    };
+}
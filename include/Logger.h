@@ -54,6 +54,7 @@ namespace interpreter
 
     void LOG_MESSAGE(ast::Node* node, MessageType type = MessageType::MESSAGE);
     void LOG_MESSAGE(std::unique_ptr<ast::Node>& node, MessageType type = MessageType::MESSAGE);
+    void LOG_MESSAGE(const Object& object, MessageType type = MessageType::MESSAGE);
     void LOG_MESSAGE(MessageType type, std::string_view message);
     void LOG_MESSAGE(std::string_view message);
 
@@ -2,28 +2,49 @@
 #include "ForwardDeclares.h"
 #include "Utility.h"
 #include "Logger.h"
+#include <array>
 #include <string>
+#include <string_view>
 #include <format>
 
 namespace interpreter
 {
-    namespace ObjectTypes
+    // Set once by the constructor of each Object type, type checks compare these instead of names
+    enum class ObjectType : uint8_t
     {
-        constexpr const char* INTEGER_OBJECT{ "int" };
-        constexpr const char* BOOLEAN_OBJECT{ "bool" };
-        constexpr const char* NULL_OBJECT{ "NULL" };
-    }
+        Integer,
+        Boolean,
+        Null,
+        Function,
+        ReturnValue,
+    };
+    // Tables indexed by ObjectType are sized with this, ReturnValue has to stay the last entry
+    constexpr size_t sObjectTypeCount{ static_cast<size_t>(ObjectType::ReturnValue) + 1 };
+
+    // Names of the types, only for diagnostics
+    constexpr std::array<std::string_view, sObjectTypeCount> sObjectTypeNames{ "int", "bool", "NULL", "fn", "return" };
 
     struct Object
     {
-        virtual ObjectType Type() const = 0;
-        virtual std::string Inspect() const = 0;
+        explicit Object(ObjectType type) : mType(type) {}
+
+        ObjectType Type() const { return mType; }
+        std::string_view TypeName() const { return sObjectTypeNames[static_cast<size_t>(mType)]; }
+        // Appends the printed value to out
+        virtual void Inspect(OutputBuffer& out) const = 0;
+        // The same text on its own
+        std::string Inspect() const;
+
+    private:
+        ObjectType mType;
     };
 
     struct IntegerType : public Object
     {
-        IntegerType() = default;
-        IntegerType(Number num) {
+        static constexpr ObjectType sType{ ObjectType::Integer };
+
+        IntegerType() : Object(sType) {}
+        IntegerType(Number num) : Object(sType) {
             if (num > INT64_MAX)
             {
                 LOG_MESSAGE(MessageType::ERRORS, std::format("Integer can't be represented in negative form due to inssuficent space: {}", num));
@@ -32,26 +53,60 @@ namespace interpreter
             mValue = num;
         }
 
-        virtual ObjectType Type() const override;
-        virtual std::string Inspect() const override;
+        using Object::Inspect;
+        virtual void Inspect(OutputBuffer& out) const override;
 
         Number mValue;
     };
 
     struct BoolType : public Object
     {
-        BoolType() = default;
-        BoolType(bool boolean) : mValue(boolean) {}
+        static constexpr ObjectType sType{ ObjectType::Boolean };
 
-        virtual ObjectType Type() const override;
-        virtual std::string Inspect() const override;
+        BoolType() : Object(sType) {}
+        BoolType(bool boolean) : Object(sType), mValue(boolean) {}
+
+        using Object::Inspect;
+        virtual void Inspect(OutputBuffer& out) const override;
 
         bool mValue;
     };
 
     struct NullType : public Object
     {
-        virtual ObjectType Type() const override;
-        virtual std::string Inspect() const override;
+        static constexpr ObjectType sType{ ObjectType::Null };
+
+        NullType() : Object(sType) {}
+
+        using Object::Inspect;
+        virtual void Inspect(OutputBuffer& out) const override;
+    };
+
+    struct FunctionType : public Object
+    {
+        static constexpr ObjectType sType{ ObjectType::Function };
+
+        FunctionType(const ast::FunctionExpression* definition, EnvironmentSharedPtr environment, SymbolRemapSharedPtr symbols) :
+            Object(sType), mDefinition(definition), mEnvironment(std::move(environment)), mSymbols(std::move(symbols)) {}
+
+        using Object::Inspect;
+        virtual void Inspect(OutputBuffer& out) const override;
+
+        const ast::FunctionExpression* mDefinition;    // Points into the tree of the Program that defined it
+        EnvironmentSharedPtr mEnvironment;              // Scope the function was created in, calls run in a scope enclosed by it
+        SymbolRemapSharedPtr mSymbols;                  // Maps the SymbolIds of the defining Program to the Evaluator's
+    };
+
+    // Wraps the value of a return statement while it unwinds the blocks it's nested in
+    struct ReturnValueType : public Object
+    {
+        static constexpr ObjectType sType{ ObjectType::ReturnValue };
+
+        ReturnValueType(ObjectSharedPtr value) : Object(sType), mValue(std::move(value)) {}
+
+        using Object::Inspect;
+        virtual void Inspect(OutputBuffer& out) const override;
+
+        ObjectSharedPtr mValue;
     };
-}
\ No newline at end of file
+}
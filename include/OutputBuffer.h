@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Growable text buffer that ast::Node::Log and Object::Inspect append into. Dumping a whole tree or a batch of values
+    // fills one string, instead of a stream and a temporary string per node. Clear keeps the memory for the next round.
+    class OutputBuffer
+    {
+    public:
+        OutputBuffer& Append(std::string_view text) { mBuffer.append(text); return *this; }
+        OutputBuffer& Append(const char* text) { mBuffer.append(text); return *this; }
+        OutputBuffer& Append(char character) { mBuffer.push_back(character); return *this; }
+        OutputBuffer& Append(Number number);
+        // Same text as streaming the Token
+        OutputBuffer& Append(const Token& token);
+
+        std::string_view View() const { return mBuffer; }
+        size_t Size() const { return mBuffer.size(); }
+        bool Empty() const { return mBuffer.empty(); }
+        void Reserve(size_t capacity) { mBuffer.reserve(capacity); }
+        void Clear() { mBuffer.clear(); }
+        // Hands the text over and leaves the buffer empty
+        std::string Release() { return std::move(mBuffer); }
+
+    private:
+        std::string mBuffer;
+    };
+}
@@ -1,81 +1,153 @@
 #pragma once
 #include "Utility.h"
 #include "AbstractSyntaxTree.h"
-#include <functional>
-#include <unordered_map>
+#include "FlatAst.h"
+#include "Diagnostics.h"
+#include <array>
 
 namespace interpreter
 {
-    typedef std::vector<Token>::const_iterator ConstTokenIterator;
-    typedef std::function<ExpressionUniquePtr()> PrefixParseFunctionPtr;
-    typedef std::function<ExpressionUniquePtr(ExpressionUniquePtr)> InfixParseFunctionPtr;
-    typedef std::unordered_map<TokenType, PrefixParseFunctionPtr> PrefixFunctionPtrMap;
-    typedef std::unordered_map<TokenType, InfixParseFunctionPtr> InfixFunctionPtrMap;
+    class Parser;
+    class IncrementalParser;
+    typedef ExpressionPtr(Parser::* PrefixParseFunctionPtr)();
+    typedef ExpressionPtr(Parser::* InfixParseFunctionPtr)(ExpressionPtr);
 
     class Parser    // Friend of Lexer
     {
     public:
-        Parser(LexerUniquePtr lexer);
+        friend IncrementalParser;
+        static constexpr size_t sDefaultStatementsPerTask{ 1024 };
 
-        ProgramUniquePtr ParseProgram();
+        Parser(LexerUniquePtr lexer);
 
-        // Evaluate
-        static ObjectSharedPtr Evaluate(ast::Node* node);
+        // The tree is built in arena, or in a fresh one. Pass in Program::RecycleArena to reuse the memory of a previous Program.
+        ProgramUniquePtr ParseProgram(ProgramArenaUniquePtr arena = nullptr);
+        // Splits the token stream into ranges of top level statements and parses them on several threads, each into its own
+        // arena. Builds the same Program and Diagnostics as ParseProgram. Streaming lexers are parsed sequentially.
+        ProgramUniquePtr ParseProgramParallel(size_t statementsPerTask = sDefaultStatementsPerTask);
+        // Errors found so far, format them with Diagnostics::Format or Diagnostics::Log
+        const Diagnostics& GetDiagnostics() const { return mDiagnostics; }
     private:
-        void RegisterParseFunctionPointers();
+        // Parses the tokens [tokenBegin, tokenEnd) of lexer as if they were a whole program, used by ParseProgramParallel
+        Parser(Lexer& lexer, size_t tokenBegin, size_t tokenEnd);
+        std::vector<size_t> FindStatementBoundaries(size_t statementsPerTask) const;
 
         // Parse Statements
-        StatementUniquePtr ParseStatement();
-        LetStatementUniquePtr ParseLetStatement();
-        ReturnStatementUniquePtr ParseReturnStatement();
-        ExpressionStatementUniquePtr ParseExpressionStatement();
-        BlockStatementUniquePtr ParseBlockStatement();
-        ConditionBlockStatementUniquePtr ParseConditionBlockStatement();
+        StatementPtr ParseStatementAndRecover();
+        void Synchronize();
+        StatementPtr ParseStatement();
+        LetStatementPtr ParseLetStatement();
+        ReturnStatementPtr ParseReturnStatement();
+        ExpressionStatementPtr ParseExpressionStatement();
+        BlockStatementPtr ParseBlockStatement();
+        ConditionBlockStatementPtr ParseConditionBlockStatement();
+        void MergeElseIfToken(const Token& elseToken);
         // Parse Expressions
-        ExpressionUniquePtr ParseExpression(ast::Precedence precedence);
-        ExpressionUniquePtr ParsePrimitiveExpression();
-        ExpressionUniquePtr ParsePrefixExpression();
-        ExpressionUniquePtr ParseGroupedExpression();
-        ExpressionUniquePtr ParseIfExpression();
-        ExpressionUniquePtr ParseFunctionExpression();
-        std::vector<ExpressionUniquePtr> ParseFunctionParameters();
-        std::vector<ExpressionUniquePtr> ParseCallArguments();
+        // A prefix operator, "(" or an infix operator that still waits for its operand. The parse functions push one instead of
+        // recursing into ParseExpression, which then parses the operand in the same loop and hands it back to the entry.
+        enum class PendingExpressionKind : uint8_t
+        {
+            PrefixOperand,
+            InfixOperand,
+            GroupedExpression,
+            CallArgument
+        };
+        struct PendingExpression
+        {
+            PendingExpressionKind mKind;
+            ast::Precedence mOperandPrecedence; // Binding power the operand is parsed with
+            ast::Precedence mPrecedence;        // Of the expression the entry is part of, parsing carries on with it once complete
+            ExpressionPtr mNode;                // Node the operand belongs to, nullptr for a grouped expression
+        };
+        ExpressionPtr ParseExpression(ast::Precedence precedence);
+        // Hands the finished operand to pending and leaves the result in expression. Returns true when pending waits for
+        // another operand, a further call argument.
+        bool CompletePendingExpression(PendingExpression& pending, ExpressionPtr& expression);
+        ExpressionPtr ParsePrimitiveExpression();
+        ExpressionPtr ParsePrefixExpression();
+        ExpressionPtr ParseGroupedExpression();
+        ExpressionPtr ParseIfExpression();
+        ExpressionPtr ParseFunctionExpression();
+        ArenaVector<ExpressionPtr> ParseFunctionParameters();
 
-        ExpressionUniquePtr ParseInfixExpression(ExpressionUniquePtr leftExpression);
-        ExpressionUniquePtr ParseCallExpression(ExpressionUniquePtr leftExpression);
+        ExpressionPtr ParseInfixExpression(ExpressionPtr leftExpression);
+        ExpressionPtr ParseCallExpression(ExpressionPtr leftExpression);
 
         // Expression precedence helpers
         ast::Precedence GetNextPrecedence();
         ast::Precedence GetCurrentPrecedence();
         ast::Precedence GetPrecedence(const Token& token);
 
-        // Evaluate
-        static ObjectSharedPtr GetNativeBoolObject(bool value);
-        static ObjectSharedPtr GetNativeNullObject();
-        static ObjectSharedPtr EvaluatePrefixExpression(TokenType operatorToken, const ObjectSharedPtr& right);
-        static ObjectSharedPtr EvaluatePrefixBangOperatorExpression(const ObjectSharedPtr& right);
-        static ObjectSharedPtr EvaluatePrefixMinusOperatorExpression(const ObjectSharedPtr& right);
-        static ObjectSharedPtr EvaluateInfixExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right);
-        static ObjectSharedPtr EvaluateInfixIntegerExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right);
-
         // Lexer utilities
+        bool FetchToken(Token& token);
+        const Token* PeekToken(size_t distance);
         void AdvanceToken();
         const Token* GetCurrentTokenAndAdvance();
         const Token* GetCurrentToken();
+        // The current token copied into the Program's arena for the AST to point at, made at most once per token
+        const Token* GetCurrentArenaToken();
         const Token* GetNextToken();
         std::tuple<const Token*, const Token*> GetTokens();
         bool NextTokenIs(TokenType tokenType);
         bool CurrentTokenIs(TokenType tokenType);
         bool TokenIs(const Token& token, TokenType tokenType);
         bool ExpectNextTokenIs(TokenType tokenType);
-        // Parse variables
-        PrefixFunctionPtrMap mPrefixFunctionPtrMap;
-        InfixFunctionPtrMap mInfixFunctionPtrMap;
-        
+        // Records an error against the token distance tokens ahead of the current one
+        void ReportError(DiagnosticCode code, size_t distance, TokenType expectedType = TokenType::ILLEGAL);
+        // Parse functions, indexed by TokenType. nullptr when the token can't start or continue an expression.
+        static constexpr std::array<PrefixParseFunctionPtr, sTokenTypeCount> sPrefixParseFunctions{ []()
+        {
+            std::array<PrefixParseFunctionPtr, sTokenTypeCount> functions{};
+            const auto Register = [&functions](TokenType tokenType, PrefixParseFunctionPtr function) { functions[static_cast<size_t>(tokenType)] = function; };
+            Register(TokenType::TRUE, &Parser::ParsePrimitiveExpression);
+            Register(TokenType::FALSE, &Parser::ParsePrimitiveExpression);
+            Register(TokenType::IDENT, &Parser::ParsePrimitiveExpression);
+            Register(TokenType::INT, &Parser::ParsePrimitiveExpression);
+            Register(TokenType::BANG, &Parser::ParsePrefixExpression);
+            Register(TokenType::MINUS, &Parser::ParsePrefixExpression);
+            Register(TokenType::LPAREN, &Parser::ParseGroupedExpression);
+            Register(TokenType::IF, &Parser::ParseIfExpression);
+            Register(TokenType::FUNCTION, &Parser::ParseFunctionExpression);
+            return functions;
+        }() };
+
+        static constexpr std::array<InfixParseFunctionPtr, sTokenTypeCount> sInfixParseFunctions{ []()
+        {
+            std::array<InfixParseFunctionPtr, sTokenTypeCount> functions{};
+            const auto Register = [&functions](TokenType tokenType, InfixParseFunctionPtr function) { functions[static_cast<size_t>(tokenType)] = function; };
+            Register(TokenType::PLUS, &Parser::ParseInfixExpression);
+            Register(TokenType::MINUS, &Parser::ParseInfixExpression);
+            Register(TokenType::SLASH, &Parser::ParseInfixExpression);
+            Register(TokenType::ASTERISK, &Parser::ParseInfixExpression);
+            Register(TokenType::EQ, &Parser::ParseInfixExpression);
+            Register(TokenType::NOT_EQ, &Parser::ParseInfixExpression);
+            Register(TokenType::LT, &Parser::ParseInfixExpression);
+            Register(TokenType::GT, &Parser::ParseInfixExpression);
+            Register(TokenType::LPAREN, &Parser::ParseCallExpression);
+            return functions;
+        }() };
+
+
         // Lexer variables
-        LexerUniquePtr mLexer;
-        ConstTokenIterator mCurrent;
-        ConstTokenIterator mNext;
-        ConstTokenIterator mEnd;
+        // Tokens are pulled into a small ring buffer, either from the Lexer's TokenStream or straight from the Lexer when it's streaming.
+        // We only ever look one token ahead, the extra slots keep previously handed out Token pointers valid for a couple of advances.
+        static constexpr size_t sLookaheadCapacity{ 4 };
+        static_assert((sLookaheadCapacity & (sLookaheadCapacity - 1)) == 0, "Lookahead capacity has to be a power of two");
+
+        LexerUniquePtr mOwnedLexer;
+        Lexer* mLexer;          // mOwnedLexer, or the parent parser's Lexer when parsing a statement range
+        ProgramArena* mArena;   // Arena of the Program being parsed
+        std::array<Token, sLookaheadCapacity> mLookahead;
+        std::array<const Token*, sLookaheadCapacity> mArenaTokens;  // Arena copy of each lookahead slot, nullptr until a node asks for it
+        std::array<uint32_t, sLookaheadCapacity> mTokenIndices;     // Stream index of each lookahead slot, for diagnostics
+        size_t mCurrent;        // ring index of the current token
+        size_t mBuffered;       // number of tokens in the ring starting at mCurrent
+        size_t mTokenIndex;     // index of the next token to fetch, into the Lexer's TokenStream unless streaming
+        size_t mTokenEnd;       // one past the last token this parser reads from the TokenStream
+        bool mReachedEnd;       // EOF token has been fetched, nothing more to pull
+        Diagnostics mDiagnostics;
+        size_t mRecoveredErrors;    // Diagnostics the parser has already synchronized after
+        std::vector<uint32_t>* mStatementEnds;  // Last token of the top level statements that didn't peek past it, for IncrementalParser
+        std::vector<PendingExpression> mPendingExpressions;  // Operators waiting for an operand, innermost last
     };
 }
\ No newline at end of file
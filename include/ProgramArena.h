@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include <utility>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Bump allocator the Parser builds a Program's AST in.
+    // Nothing allocated here is ever destroyed: the nodes only hold Tokens, arena pointers and ArenaVectors, so dropping
+    // the blocks frees the whole tree at once. Reset keeps the blocks around for the next Program (REPL lines).
+    class ProgramArena
+    {
+    public:
+        static constexpr size_t sDefaultBlockSize{ 64 * 1024 };
+
+        explicit ProgramArena(size_t blockSize = sDefaultBlockSize);
+        ProgramArena(const ProgramArena&) = delete;
+        ProgramArena& operator=(const ProgramArena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment);
+
+        template<typename T, typename... Args>
+        T* Create(Args&&... args)
+        {
+            return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Forgets everything allocated so far, the memory gets handed out again
+        void Reset();
+
+        size_t BytesAllocated() const { return mBytesAllocated; }
+        size_t BytesReserved() const;
+        size_t BlockCount() const { return mBlocks.size(); }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> mData;
+            size_t mSize;
+        };
+
+        void NextBlock(size_t minimumSize);
+
+        std::vector<Block> mBlocks;
+        size_t mBlockSize;
+        size_t mCurrentBlock;
+        std::byte* mPosition;
+        std::byte* mEnd;
+        size_t mBytesAllocated;
+    };
+
+    // Lets the containers inside AST nodes grow inside the arena, deallocate is a no-op.
+    template<typename T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        ArenaAllocator(ProgramArena& arena) : mArena(&arena) {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.mArena) {}
+
+        T* allocate(size_t count) { return static_cast<T*>(mArena->Allocate(count * sizeof(T), alignof(T))); }
+        void deallocate(T*, size_t) {}
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return mArena == other.mArena; }
+
+    private:
+        template<typename U>
+        friend class ArenaAllocator;
+
+        ProgramArena* mArena;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
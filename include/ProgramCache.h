@@ -0,0 +1,29 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include "ForwardDeclares.h"
+#include "FlatAst.h"
+
+namespace interpreter
+{
+    // Parsed programs on disk, one serialized FlatProgram per source text, named after the text's hash. A script that
+    // hasn't changed since it was stored is loaded from here and skips the Lexer and Parser. Files are memory-mapped and
+    // decoded straight out of the mapping.
+    // Stored programs are the ConstantFolder's output, a file only loads for the exact text it was written for and the
+    // ConstantFolder::sVersion that folded it.
+    class ProgramCache
+    {
+    public:
+        explicit ProgramCache(std::filesystem::path directory);
+
+        // The program stored for the text of source, nothing when there is none or the file is damaged
+        std::optional<ast::FlatProgram> Find(const SourceBufferSharedPtr& source) const;
+        // Returns false if the file couldn't be written, the cache is only ever a shortcut
+        bool Store(const ast::FlatProgram& program) const;
+
+        std::filesystem::path GetPath(const SourceBuffer& source) const;
+
+    private:
+        std::filesystem::path mDirectory;
+    };
+}
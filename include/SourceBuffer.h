@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Read-only program text that Tokens (and through them the AST) point into.
+    // Files are memory-mapped so lexing starts straight from the page cache, anything else (stdin, REPL lines) lives on the heap.
+    class SourceBuffer
+    {
+    public:
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+        ~SourceBuffer();
+
+        // Tokens keep 32-bit offsets and lengths into the text, so it can't be any longer than this
+        static constexpr size_t sMaxSize{ UINT32_MAX };
+
+        // Returns nullptr if the file can't be opened or is larger than sMaxSize.
+        static SourceBufferSharedPtr FromFile(std::string_view fileName);
+        static SourceBufferSharedPtr FromString(std::string text);
+        // Returns nullptr if the input is larger than sMaxSize.
+        static SourceBufferSharedPtr FromStream(std::istream& input);
+
+        const char* Data() const { return mData; }
+        size_t Size() const { return mSize; }
+        bool Empty() const { return mSize == 0; }
+        std::string_view View() const { return { mData, mSize }; }
+        bool IsMapped() const { return mMapping != nullptr; }
+        // Built on first use, only diagnostics need lines and columns. Safe to call from several threads.
+        const LineTable& GetLineTable() const;
+        // 64-bit FNV-1a of the text, what ProgramCache keys its files on. Computed on first use, safe to call from several threads.
+        uint64_t ContentHash() const;
+
+    private:
+        SourceBuffer() = default;
+
+        const char* mData{ nullptr };
+        size_t mSize{ 0 };
+        std::string mStorage;           // Heap backed buffers
+        void* mMapping{ nullptr };      // Memory-mapped buffers, start of the mapped view
+        mutable std::once_flag mLineTableOnce;
+        mutable std::unique_ptr<const LineTable> mLineTable;
+        mutable std::once_flag mContentHashOnce;
+        mutable uint64_t mContentHash{ 0 };
+#ifdef _WIN32
+        void* mFileHandle{ nullptr };
+        void* mMappingHandle{ nullptr };
+#endif
+    };
+}
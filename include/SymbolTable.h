@@ -0,0 +1,24 @@
+#pragma once
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <optional>
+#include "ForwardDeclares.h"
+
+namespace interpreter
+{
+    // Interns identifier spellings into dense ids so identifiers can be compared and looked up by integer.
+    // Spellings are views, they have to outlive the table (the Lexer interns straight out of its SourceBuffer).
+    class SymbolTable
+    {
+    public:
+        SymbolId Intern(std::string_view spelling);
+        std::optional<SymbolId> Find(std::string_view spelling) const;
+        std::string_view Spelling(SymbolId symbol) const;
+        size_t Size() const { return mSpellings.size(); }
+
+    private:
+        std::unordered_map<std::string_view, SymbolId> mSymbols;
+        std::vector<std::string_view> mSpellings;   // indexed by SymbolId
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -9,7 +10,7 @@
 
 namespace interpreter
 {
-    enum class TokenType
+    enum class TokenType : uint8_t
     {
         ILLEGAL,
         ENDF,   // EOF
@@ -48,35 +49,75 @@ namespace interpreter
         FALSE,
         IF,
         ELSE,
-        ELSE_IF,
+        ELSE_IF,    // Never lexed, the Parser merges "else" "if" into one token
         RETURN,
     };
+    // Tables indexed by TokenType are sized with this, RETURN has to stay the last entry
+    constexpr size_t sTokenTypeCount{ static_cast<size_t>(TokenType::RETURN) + 1 };
 
     struct Token
     {
         TokenType mType;
         TokenPrimitive mLiteral;
-        int32_t mLineNumber;
-        CharacterRange mCharacterRange[2];
+        SymbolId mSymbol{ sNoSymbol };  // Interned spelling of IDENT tokens
+        uint32_t mOffset{};             // Byte span of the token in its SourceBuffer, lines and columns come from its LineTable
+        uint32_t mLength{};
 
         static std::string ToString(TokenPrimitive);
     };
+    // Tokens are copied around by value (parser lookahead, arena copies for the AST) so keep them small and free of heap allocations.
+    static_assert(sizeof(Token) <= 64, "Token should fit into a single cache line");
 
     std::ostream& operator<<(std::ostream& out, const Token& token);
     std::ostream& operator<<(std::ostream& out, const TokenType& tokenType);
 
-    const std::unordered_map<std::string, TokenType> sKeywordsMap
+    struct Keyword
     {
+        std::string_view mLiteral;
+        TokenType mType;
+    };
+
+    // Looked up through a perfect hash generated from this table at compile time, see utility::DeriveIdentifierToken
+    constexpr std::array<Keyword, 7> sKeywords
+    { {
         {"fn",TokenType::FUNCTION},
         {"let", TokenType::LET},
         {"true", TokenType::TRUE},
         {"false", TokenType::FALSE},
         {"if", TokenType::IF},
         {"else",TokenType::ELSE},
-        {"else if", TokenType::ELSE_IF},
         {"return", TokenType::RETURN}
+    } };
+    // Literal of the ELSE_IF token the Parser merges, whatever whitespace sat between the two keywords in the source
+    constexpr std::string_view sElseIfLiteral{ "else if" };
+
+    struct Operator
+    {
+        std::string_view mLiteral;
+        TokenType mType;
     };
 
+    // The Lexer builds its DFA from this table at compile time; a new operator only needs a new entry here.
+    constexpr std::array<Operator, 16> sOperators
+    { {
+        {"=", TokenType::ASSIGN},
+        {"+", TokenType::PLUS},
+        {"-", TokenType::MINUS},
+        {"!", TokenType::BANG},
+        {"*", TokenType::ASTERISK},
+        {"/", TokenType::SLASH},
+        {"<", TokenType::LT},
+        {">", TokenType::GT},
+        {"==", TokenType::EQ},
+        {"!=", TokenType::NOT_EQ},
+        {",", TokenType::COMMA},
+        {";", TokenType::SEMICOLON},
+        {"(", TokenType::LPAREN},
+        {")", TokenType::RPAREN},
+        {"{", TokenType::LBRACE},
+        {"}", TokenType::RBRACE}
+    } };
+
     const std::unordered_map<TokenType, std::string> sTokenTypeToStringMap
     {
         {TokenType::ILLEGAL,"ILLEGAL"},
@@ -105,6 +146,7 @@ namespace interpreter
         {TokenType::FALSE, "FALSE"},
         {TokenType::IF, "IF"},
         {TokenType::ELSE, "ELSE"},
+        {TokenType::ELSE_IF, "ELSE_IF"},
         {TokenType::RETURN, "RETURN"}
     };
 
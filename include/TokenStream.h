@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <string_view>
+#include <iterator>
+#include "ForwardDeclares.h"
+#include "Token.h"
+
+namespace interpreter
+{
+    // Struct of arrays storage for lexed tokens.
+    // Literals aren't stored at all: text is rebuilt from the source through offset + length, booleans from the type,
+    // and integers live in a side table.
+    class TokenStream
+    {
+    public:
+        class ConstIterator
+        {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Token;
+
+            ConstIterator(const TokenStream* stream, size_t index) : mStream(stream), mIndex(index) {}
+
+            Token operator*() const { return mStream->Get(mIndex); }
+            ConstIterator& operator++() { ++mIndex; return *this; }
+            ConstIterator operator++(int) { ConstIterator previous{ *this }; ++mIndex; return previous; }
+            bool operator==(const ConstIterator& other) const { return mIndex == other.mIndex; }
+
+        private:
+            const TokenStream* mStream;
+            size_t mIndex;
+        };
+
+        explicit TokenStream(SourceBufferSharedPtr source);
+
+        void Reserve(size_t count);
+        void Push(const Token& token);
+        // Appends every token of other but its trailing ENDF. symbolRemap maps other's SymbolIds to ours.
+        void Append(const TokenStream& other, const std::vector<SymbolId>& symbolRemap);
+
+        size_t Size() const { return mTypes.size(); }
+        bool Empty() const { return mTypes.empty(); }
+
+        TokenType Type(size_t index) const { return mTypes[index]; }
+        uint32_t Offset(size_t index) const { return mOffsets[index]; }
+        uint32_t Length(size_t index) const { return mLengths[index]; }
+        std::string_view Text(size_t index) const;
+        // Rebuilds the full Token
+        Token Get(size_t index) const;
+
+        // Bytes held by the stream's arrays
+        size_t MemoryUsage() const;
+
+        ConstIterator begin() const { return { this, 0 }; }
+        ConstIterator end() const { return { this, Size() }; }
+
+    private:
+        SourceBufferSharedPtr mSource;
+
+        std::vector<TokenType> mTypes;
+        std::vector<uint32_t> mOffsets;
+        std::vector<uint32_t> mLengths;
+        std::vector<uint32_t> mPayloads;    // SymbolId for IDENT, index into mNumbers for INT
+        std::vector<Number> mNumbers;
+    };
+}
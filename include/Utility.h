@@ -29,19 +29,29 @@ namespace interpreter
     {
         bool IsLetter(char character);
         bool IsDigit(char character);
-        Number ToNumber(std::string_view literal);
-        // Checks for overflow on the string that's about to be turned into int64_t
-        bool ValidateStringNumber(std::string_view literal);
+        bool IsWhiteSpace(char character);
+        enum class NumberParseResult : uint8_t
+        {
+            OK,
+            OVERFLOWED,     // Doesn't fit into a signed 64 bit integer
+            INVALID_DIGIT,  // Empty or holds something other than '0' - '9'
+        };
+
+        // Converts and range checks the literal in a single pass, number is left untouched on failure
+        NumberParseResult ParseNumber(std::string_view literal, Number& number);
+        // Checked arithmetic for the evaluator and the constant folder, false when the result doesn't fit and result is left untouched
+        bool AddNumbers(Number left, Number right, Number& result);
+        bool SubtractNumbers(Number left, Number right, Number& result);
+        bool MultiplyNumbers(Number left, Number right, Number& result);
 
+        // Identifiers that both carry a SymbolId are compared by id, those have to come from the same SymbolTable
         bool CompareTokens(const Token& left, const Token& right);
         std::string ConvertTokenTypeToString(TokenType tokenType);
 
-        void AssignToToken(Token& token, TokenType tokenType, std::string_view literal, CharacterRange* characterRange);
-        void AssignToToken(Token& token, TokenType tokenType, const char literal, CharacterRange* characterRange);
-        void AssignToToken(Token& token, TokenType tokenType, Number literal, CharacterRange* characterRange);
-        void AssignToToken(Token& token, TokenType tokenType, bool literal, CharacterRange* characterRange);
+        void AssignToToken(Token& token, TokenType tokenType, std::string_view literal);
+        void AssignToToken(Token& token, TokenType tokenType, Number literal);
+        void AssignToToken(Token& token, TokenType tokenType, bool literal);
         TokenType DeriveIdentifierToken(std::string_view literal);
-        std::string ReadTextFile(std::string_view fileName);
 
         std::string DeriveType(TokenPrimitive primitive);
 
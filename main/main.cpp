@@ -4,35 +4,104 @@
 #include "AbstractSyntaxTree.h"
 #include "Parser.h"
 #include "Objects.h"
+#include "SourceBuffer.h"
+#include "FlatAst.h"
+#include "ProgramCache.h"
+#include "ConstantFolder.h"
+#include "Evaluator.h"
 
 #include <ranges>
 #include <algorithm>
 #include <vector>
 #include <filesystem>
+#include <optional>
 
-int main()
+// Parses into arena when one is given and hands the arena back once the program has been evaluated. A program that defined
+// functions goes to definingPrograms instead, the function values point into its tree.
+// With a cache the program is loaded from there when the source hasn't changed, and stored folded once it parsed without errors.
+interpreter::ProgramArenaUniquePtr Run(interpreter::SourceBufferSharedPtr source, interpreter::Evaluator& evaluator, std::vector<interpreter::ProgramUniquePtr>& definingPrograms,
+    interpreter::ProgramArenaUniquePtr arena = nullptr, const interpreter::ProgramCache* cache = nullptr)
+{
+    interpreter::ProgramUniquePtr program;
+    if (cache)
+    {
+        if (const auto cached{ cache->Find(source) })
+        {
+            program = cached->ToProgram();
+        }
+    }
+
+    if (!program)
+    {
+        interpreter::LexerUniquePtr lexer{ std::make_unique<interpreter::Lexer>(std::move(source), interpreter::LexerMode::STREAM) };
+        interpreter::Parser parser{ std::move(lexer) };
+        program = parser.ParseProgram(std::move(arena));
+        parser.GetDiagnostics().Log(*program->mSource);
+        interpreter::ast::ConstantFolder{ *program }.Fold();
+        if (cache && parser.GetDiagnostics().Count() == 0)
+        {
+            cache->Store(interpreter::ast::FlatProgram::FromProgram(*program));
+        }
+    }
+
+    const size_t functionCount{ evaluator.FunctionCount() };
+    for (const auto& object : evaluator.Evaluate(*program))
+    {
+        if (object)
+        {
+            interpreter::LOG_MESSAGE(*object);
+        }
+    }
+    //interpreter::LOG_MESSAGE(program.get());
+    if (evaluator.FunctionCount() != functionCount)
+    {
+        definingPrograms.push_back(std::move(program));
+        return nullptr;
+    }
+    return program->RecycleArena();
+}
+
+int main(int argc, char* argv[])
 {
-    std::string input;
     interpreter::Logger::SetLoggerSeverity(interpreter::MessageType::WARNING);
+    interpreter::Evaluator evaluator;
+    std::vector<interpreter::ProgramUniquePtr> definingPrograms;
+
+    // Interpreter <script|-> [cache directory]: the script is memory-mapped and lexed in place. Given a cache directory, its parsed
+    // program is kept there so the next run of the same text skips parsing, without one nothing is written.
+    if (argc > 1)
+    {
+        // "-" reads the whole script from stdin, for piping one in
+        const std::string_view scriptName{ argv[1] };
+        interpreter::SourceBufferSharedPtr source{ scriptName == "-" ? interpreter::SourceBuffer::FromStream(std::cin) : interpreter::SourceBuffer::FromFile(scriptName) };
+        if (!source)
+        {
+            std::cout << "Couldn't open " << argv[1] << '\n';
+            return 1;
+        }
+
+        const std::optional<interpreter::ProgramCache> cache{ argc > 2 ? std::optional<interpreter::ProgramCache>{ std::filesystem::path{ argv[2] } } : std::nullopt };
+        if (!source->Empty())
+        {
+            Run(std::move(source), evaluator, definingPrograms, nullptr, cache ? &*cache : nullptr);
+        }
+        return 0;
+    }
+
+    std::string input;
+    // Every line is parsed into the same arena, so after the first few lines the REPL stops allocating for the tree. Lines share
+    // the evaluator, a let on one line is visible on the next.
+    interpreter::ProgramArenaUniquePtr arena;
     std::cout << "Current Path is " << std::filesystem::current_path() << '\n';
 
     while (std::getline(std::cin, input))
     {
-        interpreter::LexerUniquePtr lexer{ std::make_unique<interpreter::Lexer>(input) };
-        interpreter::Parser parser{ std::move(lexer) };
-        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
-        for (const auto& node : program->mStatements)
+        if (input.empty())
         {
-            if (node)
-            {
-                const auto object{ interpreter::Parser::Evaluate(node.get()) };
-                if (object)
-                {
-                    interpreter::LOG_MESSAGE(object->Inspect());
-                }
-            }
+            continue;
         }
-        //interpreter::LOG_MESSAGE(program.get());
+
+        arena = Run(interpreter::SourceBuffer::FromString(std::move(input)), evaluator, definingPrograms, std::move(arena));
     }
 
     return 0;
@@ -1,301 +1,325 @@
 #include "AbstractSyntaxTree.h"
-#include <sstream>
+#include "OutputBuffer.h"
+#include <vector>
 
 namespace interpreter {
 
     namespace ast
     {
+        namespace
+        {
+            bool IsOperator(const Expression* expression)
+            {
+                return expression && (expression->mExpressionType == ExpressionType::PrefixExpression ||
+                    expression->mExpressionType == ExpressionType::InfixExpression || expression->mExpressionType == ExpressionType::CallExpression);
+            }
+
+            // Prefix, infix and call expressions nest as deep as the input does, the parser builds them without recursing.
+            // They wait on an explicit stack while their operands are written, one operand per stage. Anything else logs itself,
+            // it only nests as deep as the parser recursed.
+            void LogOperators(OutputBuffer& out, const Expression* root)
+            {
+                struct PendingExpression
+                {
+                    const Expression* mExpression;
+                    uint32_t mStage;
+                };
+                // Shared by every call on this thread so a small expression doesn't allocate, a nested call only works above its base
+                thread_local std::vector<PendingExpression> sPending;
+                std::vector<PendingExpression>& pending{ sPending };
+                const size_t base{ pending.size() };
+                pending.push_back({ root, 0 });
+
+                const auto LogOperand = [&out, &pending](const Expression* operand)
+                {
+                    if (IsOperator(operand))
+                    {
+                        pending.push_back({ operand, 0 });
+                    }
+                    else if (operand)
+                    {
+                        operand->Log(out);
+                    }
+                };
+
+                while (pending.size() != base)
+                {
+                    const Expression* expression{ pending.back().mExpression };
+                    const uint32_t stage{ pending.back().mStage++ };
+                    switch (expression->mExpressionType)
+                    {
+                    case ExpressionType::PrefixExpression:
+                    {
+                        const auto prefixExpression{ static_cast<const PrefixExpression*>(expression) };
+                        if (stage == 0)
+                        {
+                            out.Append('(').Append(prefixExpression->TokenNode());
+                            LogOperand(prefixExpression->mRightSideValue);
+                            break;
+                        }
+                        out.Append(')');
+                        pending.pop_back();
+                        break;
+                    }
+                    case ExpressionType::InfixExpression:
+                    {
+                        const auto infixExpression{ static_cast<const InfixExpression*>(expression) };
+                        if (stage == 0)
+                        {
+                            out.Append('(');
+                            VERIFY(infixExpression->mLeftExpression)
+                            {
+                                LogOperand(infixExpression->mLeftExpression);
+                            }
+                            break;
+                        }
+                        if (stage == 1)
+                        {
+                            out.Append(' ').Append(infixExpression->TokenNode()).Append(' ');
+                            LogOperand(infixExpression->mRightExpression);
+                            break;
+                        }
+                        out.Append(')');
+                        pending.pop_back();
+                        break;
+                    }
+                    default:
+                    {
+                        assert(expression->mExpressionType == ExpressionType::CallExpression);
+                        const auto callExpression{ static_cast<const CallExpression*>(expression) };
+                        const auto& arguments{ callExpression->mArguments };
+                        if (stage == 0)
+                        {
+                            VERIFY(callExpression->mFunction)
+                            {
+                                LogOperand(callExpression->mFunction);
+                            }
+                            break;
+                        }
+
+                        // Stage n writes what follows operand n - 1 and starts on argument n - 1
+                        if (stage == 1 && callExpression->mFunction)
+                        {
+                            out.Append('(');
+                        }
+                        else if (const size_t previous{ stage - 2 }; stage >= 2 && arguments[previous] && previous != arguments.size() - 1)
+                        {
+                            out.Append(", ");
+                        }
+                        if (stage - 1 < arguments.size())
+                        {
+                            LogOperand(arguments[stage - 1]);
+                            break;
+                        }
+                        out.Append(')');
+                        pending.pop_back();
+                        break;
+                    }
+                    }
+                }
+            }
+        }
+
+        std::string Node::Log() const
+        {
+            OutputBuffer out;
+            Log(out);
+            return out.Release();
+        }
+
         // ------------------------------------------------------------ Let Statement -----------------------------------------------------
 
-        std::optional<Token> LetStatement::TokenNode() { return mToken; }
         std::optional<Token> LetStatement::StatementNode() { return {}; }
 
-        std::string LetStatement::Log()
+        void LetStatement::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            if (auto tokenNode{ TokenNode() }; tokenNode)
-            {
-                result << *tokenNode << " ";
-            }
+            out.Append(TokenNode()).Append(' ');
 
             if (mIdentifier)
             {
-                if (auto identifierToken{ mIdentifier->TokenNode() })
-                {
-                    result << *identifierToken;
-                }
+                out.Append(mIdentifier->TokenNode());
             }
 
-            result << " = ";
+            out.Append(" = ");
 
             if (mValue)
             {
-                result << mValue->Log();
+                mValue->Log(out);
             }
 
-            result << ";";
-            return result.str();
+            out.Append(';');
         }
 
         // ------------------------------------------------------------ Return Statement -----------------------------------------------------
 
-        std::optional<Token> ReturnStatement::TokenNode() { return mToken; }
         std::optional<Token> ReturnStatement::StatementNode() { return {}; }
 
-        std::string ReturnStatement::Log()
+        void ReturnStatement::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            if (auto tokenNode{ TokenNode() }; tokenNode)
-            {
-                result << *tokenNode << " ";
-            }
+            out.Append(TokenNode()).Append(' ');
 
             if (mValue)
             {
-                result << mValue->Log();
+                mValue->Log(out);
             }
 
-            result << ";";
-            return result.str();
+            out.Append(';');
         }
 
         // ------------------------------------------------------------ Expression Statement -----------------------------------------------------
 
-        std::optional<Token> ExpressionStatement::TokenNode() { return mToken; }
         std::optional<Token> ExpressionStatement::StatementNode() { return {}; }
 
-        std::string ExpressionStatement::Log()
+        void ExpressionStatement::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
             if (mValue)
             {
-                result << mValue->Log();
+                mValue->Log(out);
             }
-            return result.str();
         }
 
         // ------------------------------------------------------------ Block Statement -----------------------------------------------------
 
-        std::optional<Token> BlockStatement::TokenNode() { return mToken; }
         std::optional<Token> BlockStatement::StatementNode() { return {}; }
 
-        std::string BlockStatement::Log()
+        void BlockStatement::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-            result << "{ ";
+            out.Append("{ ");
             for (const auto& statement : mStatements)
             {
-                result << statement->Log();
+                statement->Log(out);
             }
-            result << " }";
-
-            return result.str();
+            out.Append(" }");
         }
 
         // ------------------------------------------------------------ Condition Block Statement -----------------------------------------------------
 
-        std::optional<Token> ConditionBlockStatement::TokenNode() { return mToken; }
         std::optional<Token> ConditionBlockStatement::StatementNode() { return {}; }
 
-        std::string ConditionBlockStatement::Log()
+        void ConditionBlockStatement::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-            const auto tokenNode{ TokenNode() };
-            VERIFY(tokenNode);
-            result << *tokenNode;
-            VERIFY(mCondition);
-            result << mCondition->Log();
+            out.Append(TokenNode());
+            VERIFY(mCondition)
+            {
+                mCondition->Log(out);
+            }
             if (mBlock)
             {
-                result << mBlock->Log();
+                mBlock->Log(out);
             }
-
-            return result.str();
         }
 
         // ------------------------------------------------------------ Primitive Expression -----------------------------------------------------
 
-        std::optional<Token> PrimitiveExpression::TokenNode() { return mToken; }
         std::optional<Token> PrimitiveExpression::ExpressionNode() { return {}; }
 
-        std::string PrimitiveExpression::Log()
+        void PrimitiveExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            if (auto tokenNode{ TokenNode() })
-            {
-                result << *tokenNode;
-            }
-
-            return result.str();
+            out.Append(TokenNode());
         }
 
         // ------------------------------------------------------------ Prefix Expression -----------------------------------------------------
 
-        std::optional<Token> PrefixExpression::TokenNode() { return mToken; }
         std::optional<Token> PrefixExpression::ExpressionNode() { return {}; }
 
-        std::string PrefixExpression::Log()
+        void PrefixExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            const auto token{ TokenNode() };
-            VERIFY(token);
-            result << "(" << *token;
-            if (mRightSideValue)
-            {
-                result << mRightSideValue->Log();
-            }
-            result << ")";
-
-            return result.str();
+            LogOperators(out, this);
         }
 
         // ------------------------------------------------------------ Infix Expression -----------------------------------------------------
 
-        std::optional<Token> InfixExpression::TokenNode() { return mToken; }
         std::optional<Token> InfixExpression::ExpressionNode() { return {}; }
 
-        std::string InfixExpression::Log()
+        void InfixExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            result << "(";
-            VERIFY(mLeftExpression);
-            result << mLeftExpression->Log();
-            result << " " <<  mToken << " ";
-
-            if (mRightExpression)
-            {
-                result << mRightExpression->Log();
-            }
-
-            result << ")";
-            return result.str();
+            LogOperators(out, this);
         }
 
         // ------------------------------------------------------------ If Expression -----------------------------------------------------
 
-        std::optional<Token> IfExpression::TokenNode() { return mToken; }
         std::optional<Token> IfExpression::ExpressionNode() { return {}; }
 
-        std::string IfExpression::Log()
+        void IfExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
             VERIFY(mIfConditionBlock)
             {
-                result << mIfConditionBlock->Log();
+                mIfConditionBlock->Log(out);
             }
-            if (!mElseIfBlocks.empty())
+            for (const auto& conditionBlock : mElseIfBlocks)
             {
-                for (const auto& conditionBlock : mElseIfBlocks)
-                {
-                    result << conditionBlock->Log();
-                }
+                conditionBlock->Log(out);
             }
-            result << " ";
+            out.Append(' ');
 
             if (mAlternative)
             {
-                result << " else " << mAlternative->Log();
+                out.Append(" else ");
+                mAlternative->Log(out);
             }
-
-            return result.str();
         }
 
         // ------------------------------------------------------------ Function Expression -----------------------------------------------------
 
-        std::optional<Token> FunctionExpression::TokenNode() { return mToken; }
         std::optional<Token> FunctionExpression::ExpressionNode() { return {}; }
 
-        std::string FunctionExpression::Log()
+        void FunctionExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            const auto token{ TokenNode() };
-            VERIFY(token)
-            {
-                result << *token;
-            }
-            result << '(';
+            out.Append(TokenNode()).Append('(');
 
             for (int i = 0; i != mParameters.size(); i++)
             {
                 if (const auto& parameter{ mParameters[i] })
                 {
-                    result << parameter->Log();
+                    parameter->Log(out);
                     if (i != mParameters.size() - 1)
                     {
-                        result << ", ";
+                        out.Append(", ");
                     }
                 }
             }
-            result << ") ";
+            out.Append(") ");
             VERIFY(mBody)
             {
-                result << mBody->Log();
+                mBody->Log(out);
             }
-
-            return result.str();
         }
 
         // ------------------------------------------------------------ Call Expression -----------------------------------------------------
 
-        std::optional<Token> CallExpression::TokenNode() { return mToken; }
         std::optional<Token> CallExpression::ExpressionNode() { return {}; }
 
-        std::string CallExpression::Log()
+        void CallExpression::Log(OutputBuffer& out) const
         {
-            std::ostringstream result;
-
-            VERIFY(mFunction)
-            {
-                result << mFunction->Log() << '(';
-            }
-
-            for (int i = 0; i != mArguments.size(); i++)
-            {
-                if (const auto& parameter{ mArguments[i] })
-                {
-                    result << parameter->Log();
-                    if (i != mArguments.size() - 1)
-                    {
-                        result << ", ";
-                    }
-                }
-            }
-            result << ')';
-
-            return result.str();
+            LogOperators(out, this);
         }
 
         // ------------------------------------------------------------ Program -----------------------------------------------------
 
-        std::optional<Token> Program::TokenNode()
+        Program::Program(ProgramArenaUniquePtr arena /* = nullptr*/) :
+            mArena(arena ? std::move(arena) : std::make_unique<ProgramArena>())
         {
-            return {};
+            mNodeType = NodeType::Program;
         }
 
-        std::string Program::Log()
+        ProgramArenaUniquePtr Program::RecycleArena()
         {
-            std::ostringstream result;
+            mStatements.clear();
+            mSplicedArenas.clear();
+            mArena->Reset();
+            return std::move(mArena);
+        }
 
-            for (auto& statement : mStatements)
+        void Program::Log(OutputBuffer& out) const
+        {
+            for (const auto& statement : mStatements)
             {
                 if (statement)
                 {
-                    if (statement)
-                    {
-                        result << statement->Log() << std::endl;
-                    }
+                    statement->Log(out);
+                    out.Append('\n');
                 }
             }
-
-            return result.str();
         }
 
     } // namespace ast
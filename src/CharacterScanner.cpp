@@ -0,0 +1,295 @@
+#include "CharacterScanner.h"
+#include "Utility.h"
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define INTERPRETER_SCANNER_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC lets us use any intrinsic in any function, GCC and Clang need the target enabled per function.
+#define INTERPRETER_TARGET_AVX2
+#else
+#define INTERPRETER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace interpreter
+{
+    namespace scanner
+    {
+        namespace
+        {
+            // ------------------------------------------------------------ Scalar -----------------------------------------------------
+
+            const char* ScalarFindWhiteSpaceEnd(const char* begin, const char* end)
+            {
+                for (; begin != end && utility::IsWhiteSpace(*begin); ++begin)
+                {
+                }
+
+                return begin;
+            }
+
+            const char* ScalarFindIdentifierEnd(const char* begin, const char* end)
+            {
+                for (; begin != end && (utility::IsLetter(*begin) || utility::IsDigit(*begin)); ++begin)
+                {
+                }
+
+                return begin;
+            }
+
+            const char* ScalarFindDigitEnd(const char* begin, const char* end)
+            {
+                for (; begin != end && utility::IsDigit(*begin); ++begin)
+                {
+                }
+
+                return begin;
+            }
+
+            const char* ScalarFindNewLine(const char* begin, const char* end)
+            {
+                for (; begin != end && *begin != '\n'; ++begin)
+                {
+                }
+
+                return begin;
+            }
+
+#ifdef INTERPRETER_SCANNER_X64
+            // ------------------------------------------------------------ SSE2 -----------------------------------------------------
+            // SSE2 is part of the x64 baseline so these don't need a runtime check.
+            // We only load full blocks inside [begin, end) and let the scalar version handle the tail.
+
+            const char* SSE2FindWhiteSpaceEnd(const char* begin, const char* end)
+            {
+                const __m128i space{ _mm_set1_epi8(' ') };
+                const __m128i tab{ _mm_set1_epi8('\t') };
+                const __m128i carriageReturn{ _mm_set1_epi8('\r') };
+                const __m128i newLine{ _mm_set1_epi8('\n') };
+
+                for (; end - begin >= 16; begin += 16)
+                {
+                    const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)) };
+                    const __m128i whiteSpace{ _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                        _mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), _mm_cmpeq_epi8(block, newLine))) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm_movemask_epi8(whiteSpace)) };
+                    if (mask != 0xFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return ScalarFindWhiteSpaceEnd(begin, end);
+            }
+
+            const char* SSE2FindIdentifierEnd(const char* begin, const char* end)
+            {
+                // Signed compares are fine, anything >= 0x80 is negative and therefore never part of an identifier.
+                const __m128i caseBit{ _mm_set1_epi8(0x20) };
+                const __m128i beforeLowerA{ _mm_set1_epi8('a' - 1) };
+                const __m128i afterLowerZ{ _mm_set1_epi8('z' + 1) };
+                const __m128i beforeZero{ _mm_set1_epi8('0' - 1) };
+                const __m128i afterNine{ _mm_set1_epi8('9' + 1) };
+                const __m128i underscore{ _mm_set1_epi8('_') };
+
+                for (; end - begin >= 16; begin += 16)
+                {
+                    const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)) };
+                    const __m128i lower{ _mm_or_si128(block, caseBit) };
+                    const __m128i letters{ _mm_and_si128(_mm_cmpgt_epi8(lower, beforeLowerA), _mm_cmplt_epi8(lower, afterLowerZ)) };
+                    const __m128i digits{ _mm_and_si128(_mm_cmpgt_epi8(block, beforeZero), _mm_cmplt_epi8(block, afterNine)) };
+                    const __m128i identifier{ _mm_or_si128(_mm_or_si128(letters, digits), _mm_cmpeq_epi8(block, underscore)) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm_movemask_epi8(identifier)) };
+                    if (mask != 0xFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return ScalarFindIdentifierEnd(begin, end);
+            }
+
+            const char* SSE2FindDigitEnd(const char* begin, const char* end)
+            {
+                const __m128i beforeZero{ _mm_set1_epi8('0' - 1) };
+                const __m128i afterNine{ _mm_set1_epi8('9' + 1) };
+
+                for (; end - begin >= 16; begin += 16)
+                {
+                    const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)) };
+                    const __m128i digits{ _mm_and_si128(_mm_cmpgt_epi8(block, beforeZero), _mm_cmplt_epi8(block, afterNine)) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm_movemask_epi8(digits)) };
+                    if (mask != 0xFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return ScalarFindDigitEnd(begin, end);
+            }
+
+            const char* SSE2FindNewLine(const char* begin, const char* end)
+            {
+                const __m128i newLine{ _mm_set1_epi8('\n') };
+
+                for (; end - begin >= 16; begin += 16)
+                {
+                    const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)) };
+                    const uint32_t mask{ static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newLine))) };
+                    if (mask)
+                    {
+                        return begin + std::countr_zero(mask);
+                    }
+                }
+
+                return ScalarFindNewLine(begin, end);
+            }
+
+            // ------------------------------------------------------------ AVX2 -----------------------------------------------------
+
+            INTERPRETER_TARGET_AVX2 const char* AVX2FindWhiteSpaceEnd(const char* begin, const char* end)
+            {
+                const __m256i space{ _mm256_set1_epi8(' ') };
+                const __m256i tab{ _mm256_set1_epi8('\t') };
+                const __m256i carriageReturn{ _mm256_set1_epi8('\r') };
+                const __m256i newLine{ _mm256_set1_epi8('\n') };
+
+                for (; end - begin >= 32; begin += 32)
+                {
+                    const __m256i block{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)) };
+                    const __m256i whiteSpace{ _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(block, carriageReturn), _mm256_cmpeq_epi8(block, newLine))) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm256_movemask_epi8(whiteSpace)) };
+                    if (mask != 0xFFFFFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return SSE2FindWhiteSpaceEnd(begin, end);
+            }
+
+            INTERPRETER_TARGET_AVX2 const char* AVX2FindIdentifierEnd(const char* begin, const char* end)
+            {
+                const __m256i caseBit{ _mm256_set1_epi8(0x20) };
+                const __m256i beforeLowerA{ _mm256_set1_epi8('a' - 1) };
+                const __m256i afterLowerZ{ _mm256_set1_epi8('z' + 1) };
+                const __m256i beforeZero{ _mm256_set1_epi8('0' - 1) };
+                const __m256i afterNine{ _mm256_set1_epi8('9' + 1) };
+                const __m256i underscore{ _mm256_set1_epi8('_') };
+
+                for (; end - begin >= 32; begin += 32)
+                {
+                    const __m256i block{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)) };
+                    const __m256i lower{ _mm256_or_si256(block, caseBit) };
+                    const __m256i letters{ _mm256_and_si256(_mm256_cmpgt_epi8(lower, beforeLowerA), _mm256_cmpgt_epi8(afterLowerZ, lower)) };
+                    const __m256i digits{ _mm256_and_si256(_mm256_cmpgt_epi8(block, beforeZero), _mm256_cmpgt_epi8(afterNine, block)) };
+                    const __m256i identifier{ _mm256_or_si256(_mm256_or_si256(letters, digits), _mm256_cmpeq_epi8(block, underscore)) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm256_movemask_epi8(identifier)) };
+                    if (mask != 0xFFFFFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return SSE2FindIdentifierEnd(begin, end);
+            }
+
+            INTERPRETER_TARGET_AVX2 const char* AVX2FindDigitEnd(const char* begin, const char* end)
+            {
+                const __m256i beforeZero{ _mm256_set1_epi8('0' - 1) };
+                const __m256i afterNine{ _mm256_set1_epi8('9' + 1) };
+
+                for (; end - begin >= 32; begin += 32)
+                {
+                    const __m256i block{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)) };
+                    const __m256i digits{ _mm256_and_si256(_mm256_cmpgt_epi8(block, beforeZero), _mm256_cmpgt_epi8(afterNine, block)) };
+
+                    const uint32_t mask{ static_cast<uint32_t>(_mm256_movemask_epi8(digits)) };
+                    if (mask != 0xFFFFFFFF)
+                    {
+                        return begin + std::countr_zero(~mask);
+                    }
+                }
+
+                return SSE2FindDigitEnd(begin, end);
+            }
+
+            INTERPRETER_TARGET_AVX2 const char* AVX2FindNewLine(const char* begin, const char* end)
+            {
+                const __m256i newLine{ _mm256_set1_epi8('\n') };
+
+                for (; end - begin >= 32; begin += 32)
+                {
+                    const __m256i block{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)) };
+                    const uint32_t mask{ static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newLine))) };
+                    if (mask)
+                    {
+                        return begin + std::countr_zero(mask);
+                    }
+                }
+
+                return SSE2FindNewLine(begin, end);
+            }
+
+            bool SupportsAVX2()
+            {
+#ifdef _MSC_VER
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                {
+                    return false;
+                }
+
+                // The OS has to save the YMM registers on context switches as well
+                __cpuid(info, 1);
+                const bool osxsave{ (info[2] & (1 << 27)) != 0 };
+                if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+                {
+                    return false;
+                }
+
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                return __builtin_cpu_supports("avx2");
+#endif
+            }
+#endif // INTERPRETER_SCANNER_X64
+
+            std::vector<ScannerKernels> DetectSupportedKernels()
+            {
+                std::vector<ScannerKernels> kernels{ { "scalar", ScalarFindWhiteSpaceEnd, ScalarFindIdentifierEnd, ScalarFindDigitEnd, ScalarFindNewLine } };
+#ifdef INTERPRETER_SCANNER_X64
+                kernels.push_back({ "sse2", SSE2FindWhiteSpaceEnd, SSE2FindIdentifierEnd, SSE2FindDigitEnd, SSE2FindNewLine });
+                if (SupportsAVX2())
+                {
+                    kernels.push_back({ "avx2", AVX2FindWhiteSpaceEnd, AVX2FindIdentifierEnd, AVX2FindDigitEnd, AVX2FindNewLine });
+                }
+#endif
+                return kernels;
+            }
+        }
+
+        const std::vector<ScannerKernels>& GetSupportedKernels()
+        {
+            static const std::vector<ScannerKernels> sSupportedKernels{ DetectSupportedKernels() };
+            return sSupportedKernels;
+        }
+
+        const ScannerKernels& GetKernels()
+        {
+            static const ScannerKernels& sKernels{ GetSupportedKernels().back() };
+            return sKernels;
+        }
+    }
+}
@@ -0,0 +1,465 @@
+#include "ConstantFolder.h"
+#include "SourceBuffer.h"
+#include "Utility.h"
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace interpreter
+{
+    namespace ast
+    {
+        namespace
+        {
+            constexpr Number sMinNumber{ std::numeric_limits<Number>::min() };
+
+            const PrimitiveExpression* AsLiteral(const Expression* expression, ExpressionType type)
+            {
+                return expression && expression->mExpressionType == type ? static_cast<const PrimitiveExpression*>(expression) : nullptr;
+            }
+
+            // Same operators and results as Evaluator::EvaluateInfixIntegerExpression, false when the result doesn't fit
+            bool FoldIntegers(TokenType operatorToken, Number left, Number right, Number& result)
+            {
+                switch (operatorToken)
+                {
+                case TokenType::PLUS:
+                    return utility::AddNumbers(left, right, result);
+                case TokenType::MINUS:
+                    return utility::SubtractNumbers(left, right, result);
+                case TokenType::ASTERISK:
+                    return utility::MultiplyNumbers(left, right, result);
+                case TokenType::SLASH:
+                    if (right == 0 || (left == sMinNumber && right == -1))
+                    {
+                        return false;
+                    }
+                    result = left / right;
+                    return true;
+                default:
+                    return false;
+                }
+            }
+
+            // Comparisons evaluate to a bool, nothing for any other operator
+            template<typename T>
+            std::optional<bool> Compare(TokenType operatorToken, T left, T right)
+            {
+                switch (operatorToken)
+                {
+                case TokenType::EQ:
+                    return left == right;
+                case TokenType::NOT_EQ:
+                    return left != right;
+                default:
+                    break;
+                }
+
+                if constexpr (std::is_same_v<T, Number>)
+                {
+                    switch (operatorToken)
+                    {
+                    case TokenType::LT:
+                        return left < right;
+                    case TokenType::GT:
+                        return left > right;
+                    default:
+                        break;
+                    }
+                }
+                return std::nullopt;
+            }
+
+            // Truthiness of a literal condition, nothing when the condition isn't a literal. Same rule as Evaluator::IsTruthy.
+            std::optional<bool> ConstantCondition(const Expression* condition)
+            {
+                if (const auto boolean{ AsLiteral(condition, ExpressionType::BooleanExpression) })
+                {
+                    return std::get<bool>(boolean->TokenNode().mLiteral);
+                }
+                if (const auto integer{ AsLiteral(condition, ExpressionType::IntegerExpression) })
+                {
+                    return std::get<Number>(integer->TokenNode().mLiteral) != 0;
+                }
+                return std::nullopt;
+            }
+        }
+
+        ConstantFolder::ConstantFolder(Program& program) :
+            mProgram(program),
+            mStatementOffset(0),
+            mFoldedExpressions(0),
+            mPrunedBranches(0)
+        {
+        }
+
+        void ConstantFolder::Fold()
+        {
+            for (size_t statement = 0; statement != mProgram.mStatements.size(); statement++)
+            {
+                mStatementOffset = mProgram.mStatementOffsets.empty() ? 0 : mProgram.mStatementOffsets[statement];
+                FoldStatement(mProgram.mStatements[statement]);
+            }
+        }
+
+        // ------------------------------------------------------------ Statements -----------------------------------------------------
+
+        void ConstantFolder::FoldStatement(StatementPtr statement)
+        {
+            if (!statement)
+            {
+                return;
+            }
+
+            switch (statement->mNodeType)
+            {
+            case NodeType::LetStatement:
+            {
+                const auto letStatement{ static_cast<LetStatement*>(statement) };
+                letStatement->mValue = FoldExpression(letStatement->mValue);
+                break;
+            }
+            case NodeType::ReturnStatement:
+            {
+                const auto returnStatement{ static_cast<ReturnStatement*>(statement) };
+                returnStatement->mValue = FoldExpression(returnStatement->mValue);
+                break;
+            }
+            case NodeType::ExpressionStatement:
+            {
+                const auto expressionStatement{ static_cast<ExpressionStatement*>(statement) };
+                expressionStatement->mValue = FoldExpression(expressionStatement->mValue);
+                break;
+            }
+            case NodeType::BlockStatement:
+                for (const auto& blockStatement : static_cast<BlockStatement*>(statement)->mStatements)
+                {
+                    FoldStatement(blockStatement);
+                }
+                break;
+            case NodeType::ConditionBlockStatement:
+            {
+                const auto conditionBlockStatement{ static_cast<ConditionBlockStatement*>(statement) };
+                conditionBlockStatement->mCondition = FoldExpression(conditionBlockStatement->mCondition);
+                FoldStatement(conditionBlockStatement->mBlock);
+                break;
+            }
+            default:
+                assert(false);
+                break;
+            }
+        }
+
+        // ------------------------------------------------------------ Expressions -----------------------------------------------------
+
+        ExpressionPtr ConstantFolder::FoldExpression(ExpressionPtr expression)
+        {
+            if (!expression)
+            {
+                return nullptr;
+            }
+
+            switch (expression->mExpressionType)
+            {
+            case ExpressionType::PrefixExpression:
+            case ExpressionType::InfixExpression:
+            case ExpressionType::CallExpression:
+                return FoldOperators(expression);
+            case ExpressionType::IfExpression:
+                PruneIfExpression(static_cast<IfExpression*>(expression));
+                return expression;
+            case ExpressionType::FunctionExpression:
+                FoldStatement(static_cast<FunctionExpression*>(expression)->mBody);
+                return expression;
+            default:
+                return expression;
+            }
+        }
+
+        ExpressionPtr ConstantFolder::FoldOperators(ExpressionPtr root)
+        {
+            // Prefix, infix and call expressions nest as deep as the input does, the parser builds them without recursing.
+            // Their operands are folded off an explicit stack, an expression is folded once its operands are and the result
+            // takes its place in the parent. Anything else goes through FoldExpression again.
+            struct Pending
+            {
+                ExpressionPtr* mSlot;
+                bool mOperandsFolded;
+            };
+            ExpressionPtr result{ root };
+            std::vector<Pending> pending{ { &result, false } };
+
+            while (!pending.empty())
+            {
+                Pending& current{ pending.back() };
+                ExpressionPtr& slot{ *current.mSlot };
+                const ExpressionType type{ slot ? slot->mExpressionType : ExpressionType::PrimitiveExpression };
+                if (!slot || (type != ExpressionType::PrefixExpression && type != ExpressionType::InfixExpression && type != ExpressionType::CallExpression))
+                {
+                    pending.pop_back();
+                    slot = FoldExpression(slot);
+                    continue;
+                }
+
+                if (current.mOperandsFolded)
+                {
+                    pending.pop_back();
+                    if (type == ExpressionType::PrefixExpression)
+                    {
+                        slot = FoldPrefixExpression(static_cast<PrefixExpression*>(slot));
+                    }
+                    else if (type == ExpressionType::InfixExpression)
+                    {
+                        slot = FoldInfixExpression(static_cast<InfixExpression*>(slot));
+                    }
+                    continue;
+                }
+
+                current.mOperandsFolded = true;
+                switch (type)
+                {
+                case ExpressionType::PrefixExpression:
+                    pending.push_back({ &static_cast<PrefixExpression*>(slot)->mRightSideValue, false });
+                    break;
+                case ExpressionType::InfixExpression:
+                    pending.push_back({ &static_cast<InfixExpression*>(slot)->mRightExpression, false });
+                    pending.push_back({ &static_cast<InfixExpression*>(slot)->mLeftExpression, false });
+                    break;
+                default:
+                {
+                    const auto callExpression{ static_cast<CallExpression*>(slot) };
+                    for (auto& argument : callExpression->mArguments)
+                    {
+                        pending.push_back({ &argument, false });
+                    }
+                    pending.push_back({ &callExpression->mFunction, false });
+                    break;
+                }
+                }
+            }
+
+            return result;
+        }
+
+        ExpressionPtr ConstantFolder::FoldPrefixExpression(PrefixExpression* prefixExpression)
+        {
+            const ExpressionPtr operand{ prefixExpression->mRightSideValue };
+            const Token& token{ prefixExpression->TokenNode() };
+
+            if (const auto integer{ AsLiteral(operand, ExpressionType::IntegerExpression) })
+            {
+                const Number value{ std::get<Number>(integer->TokenNode().mLiteral) };
+                if (token.mType == TokenType::BANG)
+                {
+                    mFoldedExpressions++;
+                    return CreateBoolean(value == 0, token, integer->TokenNode());
+                }
+                if (token.mType == TokenType::MINUS && value != sMinNumber)
+                {
+                    mFoldedExpressions++;
+                    return CreateInteger(-value, token, integer->TokenNode());
+                }
+            }
+            else if (const auto boolean{ AsLiteral(operand, ExpressionType::BooleanExpression) })
+            {
+                if (token.mType == TokenType::BANG)
+                {
+                    mFoldedExpressions++;
+                    return CreateBoolean(!std::get<bool>(boolean->TokenNode().mLiteral), token, boolean->TokenNode());
+                }
+            }
+
+            return prefixExpression;
+        }
+
+        ExpressionPtr ConstantFolder::FoldInfixExpression(InfixExpression* infixExpression)
+        {
+            const TokenType operatorToken{ infixExpression->TokenNode().mType };
+            if (const auto left{ AsLiteral(infixExpression->mLeftExpression, ExpressionType::IntegerExpression) })
+            {
+                if (const auto right{ AsLiteral(infixExpression->mRightExpression, ExpressionType::IntegerExpression) })
+                {
+                    const Number leftValue{ std::get<Number>(left->TokenNode().mLiteral) };
+                    const Number rightValue{ std::get<Number>(right->TokenNode().mLiteral) };
+                    Number result{ 0 };
+                    if (FoldIntegers(operatorToken, leftValue, rightValue, result))
+                    {
+                        mFoldedExpressions++;
+                        return CreateInteger(result, left->TokenNode(), right->TokenNode());
+                    }
+                    if (const std::optional<bool> comparison{ Compare(operatorToken, leftValue, rightValue) })
+                    {
+                        mFoldedExpressions++;
+                        return CreateBoolean(*comparison, left->TokenNode(), right->TokenNode());
+                    }
+                }
+            }
+            else if (const auto left{ AsLiteral(infixExpression->mLeftExpression, ExpressionType::BooleanExpression) })
+            {
+                if (const auto right{ AsLiteral(infixExpression->mRightExpression, ExpressionType::BooleanExpression) })
+                {
+                    if (const std::optional<bool> comparison{ Compare(operatorToken, std::get<bool>(left->TokenNode().mLiteral), std::get<bool>(right->TokenNode().mLiteral)) })
+                    {
+                        mFoldedExpressions++;
+                        return CreateBoolean(*comparison, left->TokenNode(), right->TokenNode());
+                    }
+                }
+            }
+
+            return infixExpression;
+        }
+
+        void ConstantFolder::PruneIfExpression(IfExpression* ifExpression)
+        {
+            VERIFY(ifExpression->mIfConditionBlock)
+            {
+                FoldStatement(ifExpression->mIfConditionBlock);
+                for (const auto& elseIfBlock : ifExpression->mElseIfBlocks)
+                {
+                    FoldStatement(elseIfBlock);
+                }
+                FoldStatement(ifExpression->mAlternative);
+
+                // A constant false block never runs. A constant true block runs whenever it's reached, so nothing after it ever does.
+                std::vector<ConditionBlockStatementPtr> blocks;
+                blocks.reserve(ifExpression->mElseIfBlocks.size() + 1);
+                blocks.push_back(ifExpression->mIfConditionBlock);
+                blocks.insert(blocks.end(), ifExpression->mElseIfBlocks.begin(), ifExpression->mElseIfBlocks.end());
+                const size_t branchCount{ blocks.size() + (ifExpression->mAlternative ? 1 : 0) };
+
+                std::vector<ConditionBlockStatementPtr> kept;
+                BlockStatementPtr alternative{ ifExpression->mAlternative };
+                for (const auto& block : blocks)
+                {
+                    const std::optional<bool> condition{ ConstantCondition(block->mCondition) };
+                    if (!condition)
+                    {
+                        kept.push_back(block);
+                    }
+                    else if (*condition)
+                    {
+                        // Behind other conditions it only runs once they all failed, which is what an else does
+                        if (kept.empty())
+                        {
+                            kept.push_back(block);
+                            alternative = nullptr;
+                        }
+                        else
+                        {
+                            alternative = block->mBlock;
+                        }
+                        break;
+                    }
+                }
+
+                ConditionBlockStatementPtr first{ ifExpression->mIfConditionBlock };
+                if (kept.empty())
+                {
+                    // Every condition is false: the else becomes the only branch, without one the if is left with nothing to run
+                    if (alternative)
+                    {
+                        first->mCondition = CreateBoolean(true, first->mCondition->TokenNode(), first->mCondition->TokenNode());
+                        first->mBlock = alternative;
+                        alternative = nullptr;
+                    }
+                    else if (first->mBlock && !first->mBlock->mStatements.empty())
+                    {
+                        const auto emptyBlock{ mProgram.mArena->Create<BlockStatement>(*mProgram.mArena) };
+                        emptyBlock->mToken = first->mBlock->mToken;
+                        first->mBlock = emptyBlock;
+                    }
+                    kept.push_back(first);
+                }
+
+                // An else if that moved up to the front takes over the "if"
+                kept.front()->mToken = first->mToken;
+                ifExpression->mIfConditionBlock = kept.front();
+                ifExpression->mElseIfBlocks.assign(kept.begin() + 1, kept.end());
+                ifExpression->mAlternative = alternative;
+                mPrunedBranches += branchCount - kept.size() - (alternative ? 1 : 0);
+            }
+        }
+
+        // ------------------------------------------------------------ Literals -----------------------------------------------------
+
+        ExpressionPtr ConstantFolder::CreateInteger(Number value, const Token& begin, const Token& end)
+        {
+            const auto token{ mProgram.mArena->Create<Token>(Token{ TokenType::INT }) };
+            utility::AssignToToken(*token, TokenType::INT, value);
+            AssignSpan(*token, begin, end);
+
+            const auto literal{ mProgram.mArena->Create<PrimitiveExpression>() };
+            literal->mExpressionType = ExpressionType::IntegerExpression;
+            literal->mToken = token;
+            return literal;
+        }
+
+        ExpressionPtr ConstantFolder::CreateBoolean(bool value, const Token& begin, const Token& end)
+        {
+            const TokenType tokenType{ value ? TokenType::TRUE : TokenType::FALSE };
+            const auto token{ mProgram.mArena->Create<Token>(Token{ tokenType }) };
+            utility::AssignToToken(*token, tokenType, value);
+            AssignSpan(*token, begin, end);
+
+            const auto literal{ mProgram.mArena->Create<PrimitiveExpression>() };
+            literal->mExpressionType = ExpressionType::BooleanExpression;
+            literal->mToken = token;
+            return literal;
+        }
+
+        void ConstantFolder::AssignSpan(Token& token, const Token& begin, const Token& end) const
+        {
+            uint32_t spanBegin{ begin.mOffset };
+            uint32_t spanEnd{ end.mOffset + end.mLength };
+            if (mProgram.mSource)
+            {
+                // Whatever the span closes without opening was opened right before it and the other way around, "(1 + 2) * (3"
+                // only leaves out parentheses and the space between them. Both ends are a token or a literal folded before, their
+                // own text is balanced, so only the text between them needs a look. That keeps folding a long chain linear.
+                const std::string_view text{ mProgram.mSource->View().substr(mStatementOffset) };
+                size_t unclosed{};
+                size_t unopened{};
+                for (uint32_t position = begin.mOffset + begin.mLength; position < end.mOffset; position++)
+                {
+                    if (text[position] == '(')
+                    {
+                        unclosed++;
+                    }
+                    else if (text[position] == ')')
+                    {
+                        unclosed > 0 ? unclosed-- : unopened++;
+                    }
+                }
+
+                for (; unopened > 0 && spanBegin > 0; spanBegin--)
+                {
+                    const char character{ text[spanBegin - 1] };
+                    if (character == '(')
+                    {
+                        unopened--;
+                    }
+                    else if (!utility::IsWhiteSpace(character))
+                    {
+                        break;
+                    }
+                }
+                for (; unclosed > 0 && spanEnd < text.size(); spanEnd++)
+                {
+                    const char character{ text[spanEnd] };
+                    if (character == ')')
+                    {
+                        unclosed--;
+                    }
+                    else if (!utility::IsWhiteSpace(character))
+                    {
+                        break;
+                    }
+                }
+            }
+
+            token.mOffset = spanBegin;
+            token.mLength = spanEnd - spanBegin;
+        }
+    }
+}
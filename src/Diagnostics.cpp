@@ -0,0 +1,42 @@
+#include "Diagnostics.h"
+#include "SourceBuffer.h"
+#include "LineTable.h"
+#include "Logger.h"
+#include "Utility.h"
+#include <algorithm>
+#include <format>
+
+namespace interpreter
+{
+    void Diagnostics::Report(DiagnosticCode code, const Token& token, uint32_t tokenIndex, TokenType expected /*= TokenType::ILLEGAL*/)
+    {
+        mDiagnostics.push_back({ code, expected, token.mType, tokenIndex, token.mOffset, token.mLength });
+    }
+
+    std::string Diagnostics::Format(const Diagnostic& diagnostic, const SourceBuffer& source)
+    {
+        const SourceLocation location{ source.GetLineTable().Locate(diagnostic.mOffset) };
+        const uint32_t lastColumn{ location.mColumn + std::max<uint32_t>(diagnostic.mLength, 1) - 1 };
+
+        switch (diagnostic.mCode)
+        {
+        case DiagnosticCode::UNEXPECTED_TOKEN:
+            return std::format("line -> {} character range -> ({},{}) expected next token to be -> {} , actual type -> {}",
+                location.mLine, location.mColumn, lastColumn, utility::ConvertTokenTypeToString(diagnostic.mExpected), utility::ConvertTokenTypeToString(diagnostic.mActual));
+        case DiagnosticCode::NO_PREFIX_PARSE_FUNCTION:
+            return std::format("line -> {} character range -> ({},{}) type: {} doesn't have a function associated with it.",
+                location.mLine, location.mColumn, lastColumn, utility::ConvertTokenTypeToString(diagnostic.mActual));
+        default:
+            assert(false);
+            return {};
+        }
+    }
+
+    void Diagnostics::Log(const SourceBuffer& source) const
+    {
+        for (const Diagnostic& diagnostic : mDiagnostics)
+        {
+            Logger::Log(MessageType::ERRORS, Format(diagnostic, source));
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "Environment.h"
+#include "Objects.h"
+
+namespace interpreter
+{
+    Environment::Environment(EnvironmentSharedPtr outer) :
+        mOuter(std::move(outer))
+    {
+    }
+
+    ObjectSharedPtr Environment::Get(SymbolId symbol) const
+    {
+        for (const Environment* environment{ this }; environment; environment = environment->mOuter.get())
+        {
+            if (!environment->mOuter)
+            {
+                return symbol < environment->mValues.size() ? environment->mValues[symbol] : nullptr;
+            }
+
+            for (const auto& [boundSymbol, value] : environment->mBindings)
+            {
+                if (boundSymbol == symbol)
+                {
+                    return value;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    void Environment::Set(SymbolId symbol, ObjectSharedPtr value)
+    {
+        if (!mOuter)
+        {
+            if (symbol >= mValues.size())
+            {
+                mValues.resize(symbol + 1);
+            }
+            mValues[symbol] = std::move(value);
+            return;
+        }
+
+        for (auto& [boundSymbol, boundValue] : mBindings)
+        {
+            if (boundSymbol == symbol)
+            {
+                boundValue = std::move(value);
+                return;
+            }
+        }
+        mBindings.emplace_back(symbol, std::move(value));
+    }
+
+    void Environment::Clear()
+    {
+        mValues.clear();
+        mBindings.clear();
+    }
+
+    bool Environment::IsWithin(const Environment& scope) const
+    {
+        for (const Environment* environment{ this }; environment; environment = environment->mOuter.get())
+        {
+            if (environment == &scope)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,616 @@
+#include "Evaluator.h"
+#include "Environment.h"
+#include "Objects.h"
+#include "FlatAst.h"
+#include "Logger.h"
+#include "Utility.h"
+#include <format>
+#include <limits>
+
+namespace interpreter
+{
+    namespace
+    {
+        // The node type tags already say what a node is, the dynamic_cast only double checks them in debug builds
+        template<typename To, typename From>
+        const To* NodeCast(const From* node)
+        {
+            assert(dynamic_cast<const To*>(node));
+            return static_cast<const To*>(node);
+        }
+
+        template<typename To>
+        const To* ObjectCast(const Object* object)
+        {
+            assert(object->Type() == To::sType && dynamic_cast<const To*>(object));
+            return static_cast<const To*>(object);
+        }
+
+        bool IsReturnValue(const ObjectSharedPtr& value)
+        {
+            return value && value->Type() == ObjectType::ReturnValue;
+        }
+    }
+
+    Evaluator::Evaluator() :
+        mGlobals(std::make_shared<Environment>()),
+        mEnvironment(mGlobals),
+        mFunctionCount(0)
+    {
+    }
+
+    Evaluator::~Evaluator()
+    {
+        // Functions bound by a let hold on to the scope that holds them
+        mGlobals->Clear();
+        for (const EnvironmentWeakPtr& closedOverScope : mClosedOverScopes)
+        {
+            if (const EnvironmentSharedPtr scope{ closedOverScope.lock() })
+            {
+                scope->Clear();
+            }
+        }
+    }
+
+    std::vector<ObjectSharedPtr> Evaluator::Evaluate(const ast::Program& program)
+    {
+        mSymbolRemap = MapSymbols(program.mSymbols);
+
+        std::vector<ObjectSharedPtr> results;
+        results.reserve(program.mStatements.size());
+        for (const auto& statement : program.mStatements)
+        {
+            ObjectSharedPtr value{ statement ? EvaluateStatement(statement) : nullptr };
+            if (IsReturnValue(value))
+            {
+                results.push_back(ObjectCast<ReturnValueType>(value.get())->mValue);
+                break;
+            }
+            results.push_back(std::move(value));
+        }
+
+        mSymbolRemap = nullptr;
+        return results;
+    }
+
+    std::vector<ObjectSharedPtr> Evaluator::Evaluate(const ast::FlatProgram& program)
+    {
+        // Post-order: the values of a node's children are always computed before we get to the node
+        const std::vector<ast::FlatNode>& nodes{ program.GetNodes() };
+        std::vector<ObjectSharedPtr> values(nodes.size());
+        // A left out child evaluates to null, the same as a missing expression in the tree does
+        const auto Value = [&values](ast::NodeIndex child) -> ObjectSharedPtr
+        {
+            return child != ast::sNoNode ? values[child] : GetNativeNullObject();
+        };
+
+        for (ast::NodeIndex node = 0; node != nodes.size(); node++)
+        {
+            const ast::FlatNode& flatNode{ nodes[node] };
+            switch (flatNode.mKind)
+            {
+            case ast::FlatNodeKind::ExpressionStatement:
+                values[node] = Value(program.GetChildren(node)[0]);
+                break;
+            case ast::FlatNodeKind::IntegerExpression:
+                values[node] = std::make_shared<IntegerType>(program.GetNumber(node));
+                break;
+            case ast::FlatNodeKind::BooleanExpression:
+                values[node] = GetNativeBoolObject(program.GetBool(node));
+                break;
+            case ast::FlatNodeKind::PrefixExpression:
+                values[node] = EvaluatePrefixExpression(flatNode.mTokenType, Value(program.GetChildren(node)[0]));
+                break;
+            case ast::FlatNodeKind::InfixExpression:
+            {
+                const auto children{ program.GetChildren(node) };
+                values[node] = EvaluateInfixExpression(flatNode.mTokenType, Value(children[0]), Value(children[1]));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        std::vector<ObjectSharedPtr> results;
+        results.reserve(program.GetStatements().size());
+        for (const ast::NodeIndex statement : program.GetStatements())
+        {
+            results.push_back(std::move(values[statement]));
+        }
+        return results;
+    }
+
+    // ------------------------------------------------------------ Statements -----------------------------------------------------
+
+    ObjectSharedPtr Evaluator::EvaluateStatement(const ast::Statement* statement)
+    {
+        switch (statement->mNodeType)
+        {
+        case ast::NodeType::ExpressionStatement:
+            return EvaluateExpression(NodeCast<ast::ExpressionStatement>(statement)->mValue);
+        case ast::NodeType::LetStatement:
+            return EvaluateLetStatement(NodeCast<ast::LetStatement>(statement));
+        case ast::NodeType::ReturnStatement:
+            return EvaluateReturnStatement(NodeCast<ast::ReturnStatement>(statement));
+        case ast::NodeType::BlockStatement:
+            return EvaluateBlockStatement(NodeCast<ast::BlockStatement>(statement));
+        default:
+            // Condition blocks are only evaluated as part of their if
+            assert(false);
+            return nullptr;
+        }
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateLetStatement(const ast::LetStatement* letStatement)
+    {
+        ObjectSharedPtr value{ EvaluateExpression(letStatement->mValue) };
+        if (IsReturnValue(value))
+        {
+            return value;
+        }
+
+        const ast::Expression* identifier{ letStatement->mIdentifier };
+        VERIFY(identifier && identifier->mExpressionType == ast::ExpressionType::IdentifierExpression)
+        {
+            mEnvironment->Set(MapSymbol(NodeCast<ast::PrimitiveExpression>(identifier)->mSymbol), std::move(value));
+        }
+        return nullptr;
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateReturnStatement(const ast::ReturnStatement* returnStatement)
+    {
+        ObjectSharedPtr value{ EvaluateExpression(returnStatement->mValue) };
+        if (IsReturnValue(value))
+        {
+            return value;
+        }
+        return std::make_shared<ReturnValueType>(std::move(value));
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateBlockStatement(const ast::BlockStatement* blockStatement)
+    {
+        ObjectSharedPtr result;
+        for (const auto& statement : blockStatement->mStatements)
+        {
+            if (!statement)
+            {
+                continue;
+            }
+
+            result = EvaluateStatement(statement);
+            if (IsReturnValue(result))
+            {
+                return result;
+            }
+        }
+
+        return result ? result : GetNativeNullObject();
+    }
+
+    // ------------------------------------------------------------ Expressions -----------------------------------------------------
+
+    ObjectSharedPtr Evaluator::EvaluateExpression(const ast::Expression* expression)
+    {
+        if (!expression)
+        {
+            // Left out by a parse error, or a return without a value
+            return GetNativeNullObject();
+        }
+
+        switch (expression->mExpressionType)
+        {
+        case ast::ExpressionType::IntegerExpression:
+            return std::make_shared<IntegerType>(std::get<Number>(expression->TokenNode().mLiteral));
+        case ast::ExpressionType::BooleanExpression:
+            return GetNativeBoolObject(std::get<bool>(expression->TokenNode().mLiteral));
+        case ast::ExpressionType::IdentifierExpression:
+            return EvaluateIdentifierExpression(NodeCast<ast::PrimitiveExpression>(expression));
+        case ast::ExpressionType::PrefixExpression:
+        case ast::ExpressionType::InfixExpression:
+        case ast::ExpressionType::CallExpression:
+            return EvaluateOperators(expression);
+        case ast::ExpressionType::IfExpression:
+            return EvaluateIfExpression(NodeCast<ast::IfExpression>(expression));
+        case ast::ExpressionType::FunctionExpression:
+            return EvaluateFunctionExpression(NodeCast<ast::FunctionExpression>(expression));
+        default:
+            assert(false);
+            return GetNativeNullObject();
+        }
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateOperators(const ast::Expression* root)
+    {
+        // Prefix, infix and call expressions nest as deep as the input does, the parser builds them without recursing.
+        // They wait on mPendingExpressions while their operands are evaluated into mOperands, one operand per stage.
+        // A function body evaluated by a call comes back here on top of what's pending, its entries sit above the bases.
+        const size_t pendingBase{ mPendingExpressions.size() };
+        mPendingExpressions.push_back({ root, 0 });
+
+        while (mPendingExpressions.size() != pendingBase)
+        {
+            PendingExpression& current{ mPendingExpressions.back() };
+            const ast::Expression* expression{ current.mExpression };
+            const uint32_t stage{ current.mStage++ };
+            switch (expression->mExpressionType)
+            {
+            case ast::ExpressionType::PrefixExpression:
+            {
+                const auto prefixExpression{ NodeCast<ast::PrefixExpression>(expression) };
+                if (stage == 0)
+                {
+                    ScheduleOperand(prefixExpression->mRightSideValue);
+                    break;
+                }
+                mPendingExpressions.pop_back();
+                const ObjectSharedPtr right{ PopOperand() };
+                mOperands.push_back(EvaluatePrefixExpression(prefixExpression->TokenNode().mType, right));
+                break;
+            }
+            case ast::ExpressionType::InfixExpression:
+            {
+                const auto infixExpression{ NodeCast<ast::InfixExpression>(expression) };
+                if (stage < 2)
+                {
+                    ScheduleOperand(stage == 0 ? infixExpression->mLeftExpression : infixExpression->mRightExpression);
+                    break;
+                }
+                mPendingExpressions.pop_back();
+                const ObjectSharedPtr right{ PopOperand() };
+                const ObjectSharedPtr left{ PopOperand() };
+                mOperands.push_back(EvaluateInfixExpression(infixExpression->TokenNode().mType, left, right));
+                break;
+            }
+            default:
+            {
+                assert(expression->mExpressionType == ast::ExpressionType::CallExpression);
+                const auto callExpression{ NodeCast<ast::CallExpression>(expression) };
+                const auto& arguments{ callExpression->mArguments };
+                if (stage == 0)
+                {
+                    ScheduleOperand(callExpression->mFunction);
+                    break;
+                }
+                if (stage == 1)
+                {
+                    // The arguments are only evaluated for something that can take them
+                    const ObjectSharedPtr& callee{ mOperands.back() };
+                    if (callee->Type() != ObjectType::Function)
+                    {
+                        LOG_MESSAGE(MessageType::ERRORS, std::format("Not a function: {}", callee->Inspect()));
+                    }
+                    else if (const size_t parameterCount{ ObjectCast<FunctionType>(callee.get())->mDefinition->mParameters.size() }; arguments.size() != parameterCount)
+                    {
+                        LOG_MESSAGE(MessageType::ERRORS, std::format("Function takes {} arguments, {} given", parameterCount, arguments.size()));
+                    }
+                    else
+                    {
+                        break;
+                    }
+                    mPendingExpressions.pop_back();
+                    mOperands.back() = GetNativeNullObject();
+                    break;
+                }
+                if (stage - 2 < arguments.size())
+                {
+                    ScheduleOperand(arguments[stage - 2]);
+                    break;
+                }
+
+                mPendingExpressions.pop_back();
+                const size_t calleeIndex{ mOperands.size() - arguments.size() - 1 };
+                ObjectSharedPtr result{ CallFunction(ObjectCast<FunctionType>(mOperands[calleeIndex].get()), std::span{ mOperands }.subspan(calleeIndex + 1)) };
+                mOperands.resize(calleeIndex);
+                mOperands.push_back(std::move(result));
+                break;
+            }
+            }
+        }
+
+        return PopOperand();
+    }
+
+    void Evaluator::ScheduleOperand(const ast::Expression* operand)
+    {
+        // Anything but an operator only nests as deep as the parser recursed, it's evaluated right away
+        const bool isOperator{ operand && (operand->mExpressionType == ast::ExpressionType::PrefixExpression ||
+            operand->mExpressionType == ast::ExpressionType::InfixExpression || operand->mExpressionType == ast::ExpressionType::CallExpression) };
+        if (isOperator)
+        {
+            mPendingExpressions.push_back({ operand, 0 });
+        }
+        else
+        {
+            mOperands.push_back(EvaluateExpression(operand));
+        }
+    }
+
+    ObjectSharedPtr Evaluator::PopOperand()
+    {
+        ObjectSharedPtr operand{ std::move(mOperands.back()) };
+        mOperands.pop_back();
+        return operand;
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateIdentifierExpression(const ast::PrimitiveExpression* identifier)
+    {
+        if (ObjectSharedPtr value{ mEnvironment->Get(MapSymbol(identifier->mSymbol)) })
+        {
+            return value;
+        }
+
+        LOG_MESSAGE(MessageType::ERRORS, std::format("Identifier not found: {}", mSymbols.Spelling(MapSymbol(identifier->mSymbol))));
+        return GetNativeNullObject();
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateIfExpression(const ast::IfExpression* ifExpression)
+    {
+        const auto EvaluateConditionBlock = [this](const ast::ConditionBlockStatement* block, ObjectSharedPtr& result) -> bool
+        {
+            if (!block || !IsTruthy(EvaluateExpression(block->mCondition)))
+            {
+                return false;
+            }
+            result = block->mBlock ? EvaluateBlockStatement(block->mBlock) : GetNativeNullObject();
+            return true;
+        };
+
+        ObjectSharedPtr result;
+        if (EvaluateConditionBlock(ifExpression->mIfConditionBlock, result))
+        {
+            return result;
+        }
+        for (const auto& elseIfBlock : ifExpression->mElseIfBlocks)
+        {
+            if (EvaluateConditionBlock(elseIfBlock, result))
+            {
+                return result;
+            }
+        }
+        if (ifExpression->mAlternative)
+        {
+            return EvaluateBlockStatement(ifExpression->mAlternative);
+        }
+
+        return GetNativeNullObject();
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateFunctionExpression(const ast::FunctionExpression* functionExpression)
+    {
+        mFunctionCount++;
+        return std::make_shared<FunctionType>(functionExpression, mEnvironment, mSymbolRemap);
+    }
+
+    ObjectSharedPtr Evaluator::CallFunction(const FunctionType* function, std::span<ObjectSharedPtr> arguments)
+    {
+        // The arguments were evaluated in the caller's scope, the parameters are named in the function's Program
+        const ast::FunctionExpression* definition{ function->mDefinition };
+        const auto scope{ std::make_shared<Environment>(function->mEnvironment) };
+        for (size_t argument = 0; argument != arguments.size(); argument++)
+        {
+            const ast::Expression* parameter{ definition->mParameters[argument] };
+            VERIFY(parameter && parameter->mExpressionType == ast::ExpressionType::IdentifierExpression)
+            {
+                const SymbolId symbol{ NodeCast<ast::PrimitiveExpression>(parameter)->mSymbol };
+                scope->Set(function->mSymbols ? (*function->mSymbols)[symbol] : symbol, std::move(arguments[argument]));
+            }
+        }
+
+        EnvironmentSharedPtr callerEnvironment{ std::exchange(mEnvironment, scope) };
+        SymbolRemapSharedPtr callerSymbolRemap{ std::exchange(mSymbolRemap, function->mSymbols) };
+        ObjectSharedPtr result{ definition->mBody ? EvaluateBlockStatement(definition->mBody) : GetNativeNullObject() };
+        mEnvironment = std::move(callerEnvironment);
+        mSymbolRemap = std::move(callerSymbolRemap);
+
+        if (IsReturnValue(result))
+        {
+            result = ObjectCast<ReturnValueType>(result.get())->mValue;
+        }
+
+        // A function made in the call holds on to the call's scope, once bound in it the two keep each other alive. Lets only
+        // bind in the scope they run in, so unless the result is a closure over the scope nothing else can reach it anymore.
+        if (scope.use_count() > 1)
+        {
+            if (!(result->Type() == ObjectType::Function && ObjectCast<FunctionType>(result.get())->mEnvironment->IsWithin(*scope)))
+            {
+                scope->Clear();
+            }
+            else
+            {
+                // The closure may still leave the two behind once it's gone, whatever is left of them is cleared with the Evaluator.
+                // Scopes that went away are dropped whenever the list would have to grow.
+                if (mClosedOverScopes.size() == mClosedOverScopes.capacity())
+                {
+                    std::erase_if(mClosedOverScopes, [](const EnvironmentWeakPtr& closedOverScope) { return closedOverScope.expired(); });
+                }
+                mClosedOverScopes.push_back(scope);
+            }
+        }
+        return result;
+    }
+
+    // ------------------------------------------------------------ Operators -----------------------------------------------------
+
+    ObjectSharedPtr Evaluator::EvaluatePrefixExpression(TokenType operatorToken, const ObjectSharedPtr& right)
+    {
+        switch (operatorToken)
+        {
+        case TokenType::BANG:   // "!"
+            return EvaluatePrefixBangOperatorExpression(right);
+        case TokenType::MINUS:  // "-"
+            return EvaluatePrefixMinusOperatorExpression(right);
+        default:
+            LOG_MESSAGE(MessageType::ERRORS, std::format("No Prefix Evaluator for : {}", utility::ConvertTokenTypeToString(operatorToken)));
+            return GetNativeNullObject();
+        }
+    }
+
+    ObjectSharedPtr Evaluator::EvaluatePrefixBangOperatorExpression(const ObjectSharedPtr& right)
+    {
+        return GetNativeBoolObject(!IsTruthy(right));
+    }
+
+    ObjectSharedPtr Evaluator::EvaluatePrefixMinusOperatorExpression(const ObjectSharedPtr& right)
+    {
+        if (right->Type() != ObjectType::Integer)
+        {
+            LOG_MESSAGE(MessageType::ERRORS, std::format("Operator - not supported by {}", right->TypeName()));
+            return GetNativeNullObject();
+        }
+
+        // The operand may be bound to a variable, the result is a new object. The smallest number has no positive counterpart.
+        const Number value{ ObjectCast<IntegerType>(right.get())->mValue };
+        if (value == std::numeric_limits<Number>::min())
+        {
+            LOG_MESSAGE(MessageType::ERRORS, std::format("Integer overflow: -({})", value));
+            return GetNativeNullObject();
+        }
+        return std::make_shared<IntegerType>(-value);
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateInfixExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right)
+    {
+        VERIFY(left && right)
+        {
+            const ObjectType type{ left->Type() };
+            if (type == right->Type())
+            {
+                if (type == ObjectType::Integer)
+                {
+                    return EvaluateInfixIntegerExpression(operatorToken, ObjectCast<IntegerType>(left.get())->mValue, ObjectCast<IntegerType>(right.get())->mValue);
+                }
+                if (type == ObjectType::Boolean)
+                {
+                    return EvaluateInfixBoolExpression(operatorToken, ObjectCast<BoolType>(left.get())->mValue, ObjectCast<BoolType>(right.get())->mValue);
+                }
+            }
+        }
+
+        return GetNativeNullObject();
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateInfixIntegerExpression(TokenType operatorToken, Number left, Number right)
+    {
+        Number result{ 0 };
+        const auto Checked = [&](bool fits, std::string_view symbol)
+        {
+            if (!fits)
+            {
+                LOG_MESSAGE(MessageType::ERRORS, std::format("Integer overflow: {} {} {}", left, symbol, right));
+                return GetNativeNullObject();
+            }
+            return ObjectSharedPtr{ std::make_shared<IntegerType>(result) };
+        };
+
+        switch (operatorToken)
+        {
+        case TokenType::PLUS:       // '+'
+            return Checked(utility::AddNumbers(left, right, result), "+");
+        case TokenType::MINUS:      // '-'
+            return Checked(utility::SubtractNumbers(left, right, result), "-");
+        case TokenType::ASTERISK:   // '*'
+            return Checked(utility::MultiplyNumbers(left, right, result), "*");
+        case TokenType::SLASH:      // '/'
+            if (right == 0 || (left == std::numeric_limits<Number>::min() && right == -1))
+            {
+                LOG_MESSAGE(MessageType::ERRORS, std::format("Can't divide {} by {}", left, right));
+                return GetNativeNullObject();
+            }
+            return std::make_shared<IntegerType>(left / right);
+        case TokenType::LT:         // '<'
+            return GetNativeBoolObject(left < right);
+        case TokenType::GT:         // '>'
+            return GetNativeBoolObject(left > right);
+        case TokenType::EQ:         // '=='
+            return GetNativeBoolObject(left == right);
+        case TokenType::NOT_EQ:     // '!='
+            return GetNativeBoolObject(left != right);
+        default:
+            LOG(MessageType::ERRORS, "Operator : ", operatorToken, " not supported by Number types.");
+            return GetNativeNullObject();
+        }
+    }
+
+    ObjectSharedPtr Evaluator::EvaluateInfixBoolExpression(TokenType operatorToken, bool left, bool right)
+    {
+        switch (operatorToken)
+        {
+        case TokenType::EQ:         // '=='
+            return GetNativeBoolObject(left == right);
+        case TokenType::NOT_EQ:     // '!='
+            return GetNativeBoolObject(left != right);
+        default:
+            LOG(MessageType::ERRORS, "Operator : ", operatorToken, " not supported by bool types.");
+            return GetNativeNullObject();
+        }
+    }
+
+    // ------------------------------------------------------------ Values -----------------------------------------------------
+
+    bool Evaluator::IsTruthy(const ObjectSharedPtr& value)
+    {
+        switch (value->Type())
+        {
+        case ObjectType::Boolean:
+            return ObjectCast<BoolType>(value.get())->mValue;
+        case ObjectType::Integer:
+            return ObjectCast<IntegerType>(value.get())->mValue != 0;
+        case ObjectType::Null:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    ObjectSharedPtr Evaluator::GetNativeBoolObject(bool value)
+    {
+        static std::shared_ptr<BoolType> nativeTrue{ std::make_shared<BoolType>(true) };
+        static std::shared_ptr<BoolType> nativeFalse{ std::make_shared<BoolType>(false) };
+
+        if (value)
+        {
+            return nativeTrue;
+        }
+
+        return nativeFalse;
+    }
+
+    ObjectSharedPtr Evaluator::GetNativeNullObject()
+    {
+        static std::shared_ptr<NullType> nativeNull{ std::make_shared<NullType>() };
+
+        return nativeNull;
+    }
+
+    // ------------------------------------------------------------ Symbols -----------------------------------------------------
+
+    SymbolId Evaluator::MapSymbol(SymbolId symbol) const
+    {
+        if (!mSymbolRemap)
+        {
+            return symbol;
+        }
+
+        assert(symbol < mSymbolRemap->size());
+        return (*mSymbolRemap)[symbol];
+    }
+
+    SymbolRemapSharedPtr Evaluator::MapSymbols(const SymbolTableSharedPtr& symbols)
+    {
+        auto symbolRemap{ std::make_shared<std::vector<SymbolId>>() };
+        if (!symbols)
+        {
+            return symbolRemap;
+        }
+
+        symbolRemap->reserve(symbols->Size());
+        for (SymbolId symbol = 0; symbol < symbols->Size(); symbol++)
+        {
+            const std::string_view spelling{ symbols->Spelling(symbol) };
+            const std::optional<SymbolId> known{ mSymbols.Find(spelling) };
+            symbolRemap->push_back(known ? *known : mSymbols.Intern(mSymbolSpellings.emplace_back(spelling)));
+        }
+        return symbolRemap;
+    }
+}
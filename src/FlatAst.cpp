@@ -0,0 +1,982 @@
+#include "FlatAst.h"
+#include "AbstractSyntaxTree.h"
+#include "SourceBuffer.h"
+#include "SymbolTable.h"
+#include "Utility.h"
+#include <array>
+#include <variant>
+
+namespace interpreter
+{
+    namespace ast
+    {
+        namespace
+        {
+            // Serialized layout, every integer is a LEB128 varint unless noted:
+            //   "IAST" version treeVersion sourceHash (8 bytes, little endian) sourceSize sourceText (sourceSize raw bytes)
+            //   symbolCount { offset length }      the spelling of every SymbolId as a span of the source
+            //   numberCount { zigzag(number) }
+            //   nodeCount { kind tokenType zigzag(offset - previous offset) length (payload | childCount { node - child }) }
+            //   statementCount { node }
+            // A child link of 0 is sNoNode, real children come before their parent so their distance is at least 1.
+            // The hash only turns most other texts down early, the text itself is what decides whether the image belongs to a source.
+            constexpr std::string_view sMagic{ "IAST" };
+            constexpr uint64_t sFormatVersion{ 2 };
+            constexpr size_t sFlatNodeKindCount{ static_cast<size_t>(FlatNodeKind::CallExpression) + 1 };
+
+            bool IsLeaf(FlatNodeKind kind)
+            {
+                return kind == FlatNodeKind::IdentifierExpression || kind == FlatNodeKind::IntegerExpression || kind == FlatNodeKind::BooleanExpression;
+            }
+
+            // The walks index children without checking, a loaded node has to have what the converter would have given it
+            bool IsValidChildCount(FlatNodeKind kind, uint32_t childCount)
+            {
+                switch (kind)
+                {
+                case FlatNodeKind::LetStatement:
+                case FlatNodeKind::ConditionBlockStatement:
+                case FlatNodeKind::InfixExpression:
+                    return childCount == 2;
+                case FlatNodeKind::ReturnStatement:
+                case FlatNodeKind::ExpressionStatement:
+                case FlatNodeKind::PrefixExpression:
+                    return childCount == 1;
+                case FlatNodeKind::IfExpression:
+                    return childCount >= 2;
+                case FlatNodeKind::FunctionExpression:
+                case FlatNodeKind::CallExpression:
+                    return childCount >= 1;
+                default:
+                    return true;
+                }
+            }
+
+            bool IsExpression(FlatNodeKind kind)
+            {
+                switch (kind)
+                {
+                case FlatNodeKind::IdentifierExpression:
+                case FlatNodeKind::IntegerExpression:
+                case FlatNodeKind::BooleanExpression:
+                case FlatNodeKind::PrefixExpression:
+                case FlatNodeKind::InfixExpression:
+                case FlatNodeKind::IfExpression:
+                case FlatNodeKind::FunctionExpression:
+                case FlatNodeKind::CallExpression:
+                    return true;
+                default:
+                    return false;
+                }
+            }
+
+            // What the top level and blocks can hold, condition blocks only ever sit in an if
+            bool IsStatement(FlatNodeKind kind)
+            {
+                return kind == FlatNodeKind::LetStatement || kind == FlatNodeKind::ReturnStatement || kind == FlatNodeKind::ExpressionStatement || kind == FlatNodeKind::BlockStatement;
+            }
+
+            // The token type is what FromProgram tells the literal kinds apart by, it has to agree with the kind and payload
+            bool IsValidLeaf(const FlatNode& flatNode)
+            {
+                const bool boolean{ flatNode.mTokenType == TokenType::TRUE || flatNode.mTokenType == TokenType::FALSE };
+                switch (flatNode.mKind)
+                {
+                case FlatNodeKind::IntegerExpression:
+                    return flatNode.mTokenType == TokenType::INT;
+                case FlatNodeKind::BooleanExpression:
+                    return boolean && flatNode.mPayload == (flatNode.mTokenType == TokenType::TRUE);
+                default:
+                    return !boolean && flatNode.mTokenType != TokenType::INT;
+                }
+            }
+
+            // ToProgram static_casts every child to what its position calls for, so a loaded child has to be of that kind.
+            // A missing child is only allowed where the parser can leave one out and the walks check for it.
+            bool IsValidChild(FlatNodeKind kind, uint32_t position, uint32_t childCount, const FlatNode* child)
+            {
+                const auto Expression = [child]() { return child && IsExpression(child->mKind); };
+                const auto Is = [child](FlatNodeKind childKind) { return child && child->mKind == childKind; };
+                switch (kind)
+                {
+                case FlatNodeKind::LetStatement:
+                    return position == 0 ? Is(FlatNodeKind::IdentifierExpression) : !child || Expression();
+                case FlatNodeKind::ReturnStatement:
+                case FlatNodeKind::ExpressionStatement:
+                case FlatNodeKind::PrefixExpression:
+                    return !child || Expression();
+                case FlatNodeKind::BlockStatement:
+                    return child && IsStatement(child->mKind);
+                case FlatNodeKind::ConditionBlockStatement:
+                    return position == 0 ? Expression() : !child || Is(FlatNodeKind::BlockStatement);
+                case FlatNodeKind::InfixExpression:
+                    return position == 0 ? Expression() : !child || Expression();
+                case FlatNodeKind::IfExpression:
+                    return position == childCount - 1 ? !child || Is(FlatNodeKind::BlockStatement) : Is(FlatNodeKind::ConditionBlockStatement);
+                case FlatNodeKind::FunctionExpression:
+                    return position == 0 ? Is(FlatNodeKind::BlockStatement) : Is(FlatNodeKind::IdentifierExpression);
+                case FlatNodeKind::CallExpression:
+                    return position == 0 ? Expression() : !child || Expression();
+                default:
+                    return false;
+                }
+            }
+
+            void WriteVarint(std::string& out, uint64_t value)
+            {
+                while (value >= 0x80)
+                {
+                    out += static_cast<char>((value & 0x7F) | 0x80);
+                    value >>= 7;
+                }
+                out += static_cast<char>(value);
+            }
+
+            uint64_t ZigZag(int64_t value)
+            {
+                return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+            }
+
+            int64_t UnZigZag(uint64_t value)
+            {
+                return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+            }
+
+            // Cache files can be truncated or damaged. A failed read sticks and returns 0, the caller checks once at the end.
+            class ByteReader
+            {
+            public:
+                explicit ByteReader(std::string_view bytes) : mCurrent(bytes.data()), mEnd(bytes.data() + bytes.size()), mFailed(false) {}
+
+                uint64_t ReadVarint()
+                {
+                    uint64_t value{ 0 };
+                    for (uint32_t shift = 0; shift < 64 && mCurrent != mEnd; shift += 7)
+                    {
+                        const uint8_t byte{ static_cast<uint8_t>(*mCurrent++) };
+                        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                        if (!(byte & 0x80))
+                        {
+                            return value;
+                        }
+                    }
+                    return Fail();
+                }
+
+                uint64_t ReadFixed64()
+                {
+                    if (mEnd - mCurrent < 8)
+                    {
+                        return Fail();
+                    }
+                    uint64_t value{ 0 };
+                    for (size_t i = 0; i != 8; i++)
+                    {
+                        value |= static_cast<uint64_t>(static_cast<uint8_t>(*mCurrent++)) << (i * 8);
+                    }
+                    return value;
+                }
+
+                // The next count bytes as they are
+                std::string_view ReadBytes(uint64_t count)
+                {
+                    if (static_cast<uint64_t>(mEnd - mCurrent) < count)
+                    {
+                        Fail();
+                        return {};
+                    }
+                    const std::string_view bytes{ mCurrent, static_cast<size_t>(count) };
+                    mCurrent += count;
+                    return bytes;
+                }
+
+                // A varint that has to be below limit
+                uint32_t ReadIndex(uint64_t limit)
+                {
+                    const uint64_t value{ ReadVarint() };
+                    return value < limit ? utility::narrow_cast<uint32_t>(value) : static_cast<uint32_t>(Fail());
+                }
+
+                // Every element takes at least a byte, so a damaged count can't make us allocate more than the file holds
+                uint32_t ReadCount()
+                {
+                    return ReadIndex(std::min<uint64_t>(static_cast<uint64_t>(mEnd - mCurrent) + 1, UINT32_MAX));
+                }
+
+                bool Failed() const { return mFailed; }
+                bool AtEnd() const { return mCurrent == mEnd; }
+
+            private:
+                uint64_t Fail()
+                {
+                    mFailed = true;
+                    mCurrent = mEnd;
+                    return 0;
+                }
+
+                const char* mCurrent;
+                const char* mEnd;
+                bool mFailed;
+            };
+        }
+
+        // ------------------------------------------------------------ Conversion -----------------------------------------------------
+
+        FlatProgram FlatProgram::FromProgram(const Program& program)
+        {
+            FlatProgram flatProgram;
+            flatProgram.mSource = program.mSource;
+            flatProgram.mSymbols = program.mSymbols;
+            flatProgram.mStatements.reserve(program.mStatements.size());
+
+            for (size_t statement = 0; statement != program.mStatements.size(); statement++)
+            {
+                const size_t firstNode{ flatProgram.mNodes.size() };
+                flatProgram.mStatements.push_back(flatProgram.Convert(program.mStatements[statement]));
+                if (!program.mStatementOffsets.empty())
+                {
+                    for (size_t node = firstNode; node != flatProgram.mNodes.size(); node++)
+                    {
+                        flatProgram.mNodes[node].mOffset += program.mStatementOffsets[statement];
+                    }
+                }
+            }
+
+            return flatProgram;
+        }
+
+        NodeIndex FlatProgram::Convert(const Node* node)
+        {
+            if (!node)
+            {
+                return sNoNode;
+            }
+
+            // Children are converted before their parent is added, that's what keeps the node array in post-order.
+            switch (node->mNodeType)
+            {
+            case NodeType::LetStatement:
+            {
+                const auto letStatement{ static_cast<const LetStatement*>(node) };
+                const std::array children{ Convert(letStatement->mIdentifier), Convert(letStatement->mValue) };
+                return AddNode(FlatNodeKind::LetStatement, letStatement->TokenNode(), children);
+            }
+            case NodeType::ReturnStatement:
+            {
+                const auto returnStatement{ static_cast<const ReturnStatement*>(node) };
+                const std::array children{ Convert(returnStatement->mValue) };
+                return AddNode(FlatNodeKind::ReturnStatement, returnStatement->TokenNode(), children);
+            }
+            case NodeType::ExpressionStatement:
+            {
+                const auto expressionStatement{ static_cast<const ExpressionStatement*>(node) };
+                const std::array children{ Convert(expressionStatement->mValue) };
+                return AddNode(FlatNodeKind::ExpressionStatement, expressionStatement->TokenNode(), children);
+            }
+            case NodeType::BlockStatement:
+            {
+                const auto blockStatement{ static_cast<const BlockStatement*>(node) };
+                std::vector<NodeIndex> children;
+                children.reserve(blockStatement->mStatements.size());
+                for (const auto& statement : blockStatement->mStatements)
+                {
+                    children.push_back(Convert(statement));
+                }
+                return AddNode(FlatNodeKind::BlockStatement, blockStatement->TokenNode(), children);
+            }
+            case NodeType::ConditionBlockStatement:
+            {
+                const auto conditionBlockStatement{ static_cast<const ConditionBlockStatement*>(node) };
+                const std::array children{ Convert(conditionBlockStatement->mCondition), Convert(conditionBlockStatement->mBlock) };
+                return AddNode(FlatNodeKind::ConditionBlockStatement, conditionBlockStatement->TokenNode(), children);
+            }
+            case NodeType::Expression:
+                break;
+            default:
+                assert(false);
+                return sNoNode;
+            }
+
+            const auto expression{ static_cast<const Expression*>(node) };
+            switch (expression->mExpressionType)
+            {
+            case ExpressionType::PrimitiveExpression:
+            case ExpressionType::IdentifierExpression:
+            case ExpressionType::IntegerExpression:
+            case ExpressionType::BooleanExpression:
+            {
+                const auto primitiveExpression{ static_cast<const PrimitiveExpression*>(expression) };
+                const Token& token{ primitiveExpression->TokenNode() };
+                if (token.mType == TokenType::INT)
+                {
+                    mNumbers.push_back(std::get<Number>(token.mLiteral));
+                    return AddLeaf(FlatNodeKind::IntegerExpression, token, utility::narrow_cast<uint32_t>(mNumbers.size() - 1));
+                }
+                else if (token.mType == TokenType::TRUE || token.mType == TokenType::FALSE)
+                {
+                    return AddLeaf(FlatNodeKind::BooleanExpression, token, token.mType == TokenType::TRUE);
+                }
+                return AddLeaf(FlatNodeKind::IdentifierExpression, token, primitiveExpression->mSymbol);
+            }
+            case ExpressionType::PrefixExpression:
+            case ExpressionType::InfixExpression:
+            case ExpressionType::CallExpression:
+                return ConvertOperators(expression);
+            case ExpressionType::IfExpression:
+            {
+                const auto ifExpression{ static_cast<const IfExpression*>(expression) };
+                std::vector<NodeIndex> children;
+                children.reserve(ifExpression->mElseIfBlocks.size() + 2);
+                children.push_back(Convert(ifExpression->mIfConditionBlock));
+                for (const auto& elseIfBlock : ifExpression->mElseIfBlocks)
+                {
+                    children.push_back(Convert(elseIfBlock));
+                }
+                children.push_back(Convert(ifExpression->mAlternative));
+                return AddNode(FlatNodeKind::IfExpression, ifExpression->TokenNode(), children);
+            }
+            case ExpressionType::FunctionExpression:
+            {
+                const auto functionExpression{ static_cast<const FunctionExpression*>(expression) };
+                std::vector<NodeIndex> children;
+                children.reserve(functionExpression->mParameters.size() + 1);
+                children.push_back(Convert(functionExpression->mBody));
+                for (const auto& parameter : functionExpression->mParameters)
+                {
+                    children.push_back(Convert(parameter));
+                }
+                return AddNode(FlatNodeKind::FunctionExpression, functionExpression->TokenNode(), children);
+            }
+            default:
+                assert(false);
+                return sNoNode;
+            }
+        }
+
+        NodeIndex FlatProgram::ConvertOperators(const Expression* root)
+        {
+            // Prefix, infix and call expressions nest as deep as the input does, the parser builds them without recursing.
+            // Their operands are converted off an explicit stack, anything else goes through Convert again.
+            constexpr size_t sNotExpanded{ SIZE_MAX };
+            struct Pending
+            {
+                const Expression* mExpression;
+                size_t mFirstChild;     // Where its operands start in converted once they're pushed
+            };
+            std::vector<Pending> pending{ { root, sNotExpanded } };
+            std::vector<NodeIndex> converted;
+            std::vector<const Expression*> operands;
+
+            while (!pending.empty())
+            {
+                const Pending current{ pending.back() };
+                const Expression* expression{ current.mExpression };
+                const bool isOperator{ expression && (expression->mExpressionType == ExpressionType::PrefixExpression ||
+                    expression->mExpressionType == ExpressionType::InfixExpression || expression->mExpressionType == ExpressionType::CallExpression) };
+                if (!isOperator)
+                {
+                    pending.pop_back();
+                    converted.push_back(Convert(expression));
+                    continue;
+                }
+
+                if (current.mFirstChild == sNotExpanded)
+                {
+                    operands.clear();
+                    switch (expression->mExpressionType)
+                    {
+                    case ExpressionType::PrefixExpression:
+                        operands.push_back(static_cast<const PrefixExpression*>(expression)->mRightSideValue);
+                        break;
+                    case ExpressionType::InfixExpression:
+                        operands.push_back(static_cast<const InfixExpression*>(expression)->mLeftExpression);
+                        operands.push_back(static_cast<const InfixExpression*>(expression)->mRightExpression);
+                        break;
+                    default:
+                    {
+                        const auto callExpression{ static_cast<const CallExpression*>(expression) };
+                        operands.push_back(callExpression->mFunction);
+                        operands.insert(operands.end(), callExpression->mArguments.begin(), callExpression->mArguments.end());
+                        break;
+                    }
+                    }
+
+                    // Back to front, so the operands are converted in order and the node array stays in post-order
+                    pending.back().mFirstChild = converted.size();
+                    for (auto operand = operands.rbegin(); operand != operands.rend(); operand++)
+                    {
+                        pending.push_back({ *operand, sNotExpanded });
+                    }
+                    continue;
+                }
+
+                pending.pop_back();
+                const FlatNodeKind kind{ expression->mExpressionType == ExpressionType::PrefixExpression ? FlatNodeKind::PrefixExpression :
+                    expression->mExpressionType == ExpressionType::InfixExpression ? FlatNodeKind::InfixExpression : FlatNodeKind::CallExpression };
+                const NodeIndex node{ AddNode(kind, expression->TokenNode(), std::span<const NodeIndex>{ converted }.subspan(current.mFirstChild)) };
+                converted.resize(current.mFirstChild);
+                converted.push_back(node);
+            }
+
+            return converted.back();
+        }
+
+        NodeIndex FlatProgram::AddNode(FlatNodeKind kind, const Token& token, std::span<const NodeIndex> children)
+        {
+            const uint32_t firstChild{ utility::narrow_cast<uint32_t>(mChildren.size()) };
+            mChildren.insert(mChildren.end(), children.begin(), children.end());
+            mNodes.push_back({ kind, token.mType, token.mOffset, token.mLength, utility::narrow_cast<uint32_t>(children.size()), firstChild });
+            return utility::narrow_cast<NodeIndex>(mNodes.size() - 1);
+        }
+
+        NodeIndex FlatProgram::AddLeaf(FlatNodeKind kind, const Token& token, uint32_t payload)
+        {
+            mNodes.push_back({ kind, token.mType, token.mOffset, token.mLength, 0, payload });
+            return utility::narrow_cast<NodeIndex>(mNodes.size() - 1);
+        }
+
+        ProgramUniquePtr FlatProgram::ToProgram() const
+        {
+            auto program{ std::make_unique<Program>() };
+            program->mSource = mSource;
+            program->mSymbols = mSymbols;
+            ProgramArena& arena{ *program->mArena };
+
+            // Post-order again: the children of a node are built by the time we get to it
+            std::vector<Node*> nodes(mNodes.size());
+            const auto Child = [&nodes](NodeIndex child) -> Node* { return child == sNoNode ? nullptr : nodes[child]; };
+            const auto ExpressionChild = [&Child](NodeIndex child) { return static_cast<ExpressionPtr>(Child(child)); };
+            const auto BlockChild = [&Child](NodeIndex child) { return static_cast<BlockStatementPtr>(Child(child)); };
+            const auto ConditionBlockChild = [&Child](NodeIndex child) { return static_cast<ConditionBlockStatementPtr>(Child(child)); };
+
+            for (NodeIndex node = 0; node != mNodes.size(); node++)
+            {
+                const std::span<const NodeIndex> children{ GetChildren(node) };
+                const Token* token{ arena.Create<Token>(GetToken(node)) };
+
+                switch (mNodes[node].mKind)
+                {
+                case FlatNodeKind::LetStatement:
+                {
+                    const auto letStatement{ arena.Create<LetStatement>() };
+                    letStatement->mToken = token;
+                    letStatement->mIdentifier = ExpressionChild(children[0]);
+                    letStatement->mValue = ExpressionChild(children[1]);
+                    nodes[node] = letStatement;
+                    break;
+                }
+                case FlatNodeKind::ReturnStatement:
+                {
+                    const auto returnStatement{ arena.Create<ReturnStatement>() };
+                    returnStatement->mToken = token;
+                    returnStatement->mValue = ExpressionChild(children[0]);
+                    nodes[node] = returnStatement;
+                    break;
+                }
+                case FlatNodeKind::ExpressionStatement:
+                {
+                    const auto expressionStatement{ arena.Create<ExpressionStatement>() };
+                    expressionStatement->mToken = token;
+                    expressionStatement->mValue = ExpressionChild(children[0]);
+                    nodes[node] = expressionStatement;
+                    break;
+                }
+                case FlatNodeKind::BlockStatement:
+                {
+                    const auto blockStatement{ arena.Create<BlockStatement>(arena) };
+                    blockStatement->mToken = token;
+                    blockStatement->mStatements.reserve(children.size());
+                    for (const NodeIndex child : children)
+                    {
+                        blockStatement->mStatements.push_back(static_cast<StatementPtr>(Child(child)));
+                    }
+                    nodes[node] = blockStatement;
+                    break;
+                }
+                case FlatNodeKind::ConditionBlockStatement:
+                {
+                    const auto conditionBlockStatement{ arena.Create<ConditionBlockStatement>() };
+                    conditionBlockStatement->mToken = token;
+                    conditionBlockStatement->mCondition = ExpressionChild(children[0]);
+                    conditionBlockStatement->mBlock = BlockChild(children[1]);
+                    nodes[node] = conditionBlockStatement;
+                    break;
+                }
+                case FlatNodeKind::IdentifierExpression:
+                case FlatNodeKind::IntegerExpression:
+                case FlatNodeKind::BooleanExpression:
+                {
+                    const auto primitiveExpression{ arena.Create<PrimitiveExpression>() };
+                    primitiveExpression->mToken = token;
+                    if (mNodes[node].mKind == FlatNodeKind::IdentifierExpression)
+                    {
+                        primitiveExpression->mExpressionType = ExpressionType::IdentifierExpression;
+                        primitiveExpression->mSymbol = GetSymbol(node);
+                    }
+                    else
+                    {
+                        primitiveExpression->mExpressionType = mNodes[node].mKind == FlatNodeKind::IntegerExpression ? ExpressionType::IntegerExpression : ExpressionType::BooleanExpression;
+                    }
+                    nodes[node] = primitiveExpression;
+                    break;
+                }
+                case FlatNodeKind::PrefixExpression:
+                {
+                    const auto prefixExpression{ arena.Create<PrefixExpression>() };
+                    prefixExpression->mToken = token;
+                    prefixExpression->mRightSideValue = ExpressionChild(children[0]);
+                    nodes[node] = prefixExpression;
+                    break;
+                }
+                case FlatNodeKind::InfixExpression:
+                {
+                    const auto infixExpression{ arena.Create<InfixExpression>() };
+                    infixExpression->mToken = token;
+                    infixExpression->mLeftExpression = ExpressionChild(children[0]);
+                    infixExpression->mRightExpression = ExpressionChild(children[1]);
+                    nodes[node] = infixExpression;
+                    break;
+                }
+                case FlatNodeKind::IfExpression:
+                {
+                    const auto ifExpression{ arena.Create<IfExpression>(arena) };
+                    ifExpression->mToken = token;
+                    ifExpression->mIfConditionBlock = ConditionBlockChild(children[0]);
+                    for (const NodeIndex child : children.subspan(1, children.size() - 2))
+                    {
+                        ifExpression->mElseIfBlocks.push_back(ConditionBlockChild(child));
+                    }
+                    ifExpression->mAlternative = BlockChild(children.back());
+                    nodes[node] = ifExpression;
+                    break;
+                }
+                case FlatNodeKind::FunctionExpression:
+                {
+                    const auto functionExpression{ arena.Create<FunctionExpression>(arena) };
+                    functionExpression->mToken = token;
+                    functionExpression->mBody = BlockChild(children[0]);
+                    for (const NodeIndex child : children.subspan(1))
+                    {
+                        functionExpression->mParameters.push_back(ExpressionChild(child));
+                    }
+                    nodes[node] = functionExpression;
+                    break;
+                }
+                case FlatNodeKind::CallExpression:
+                {
+                    const auto callExpression{ arena.Create<CallExpression>(arena) };
+                    callExpression->mToken = token;
+                    callExpression->mFunction = ExpressionChild(children[0]);
+                    for (const NodeIndex child : children.subspan(1))
+                    {
+                        callExpression->mArguments.push_back(ExpressionChild(child));
+                    }
+                    nodes[node] = callExpression;
+                    break;
+                }
+                }
+            }
+
+            program->mStatements.reserve(mStatements.size());
+            for (const NodeIndex statement : mStatements)
+            {
+                program->mStatements.push_back(static_cast<StatementPtr>(Child(statement)));
+            }
+            return program;
+        }
+
+        // ------------------------------------------------------------ Serialization -----------------------------------------------------
+
+        std::string FlatProgram::Serialize(uint64_t treeVersion /*= 0*/) const
+        {
+            const std::string_view text{ mSource->View() };
+            std::string out;
+            out.reserve(64 + text.size() + mNodes.size() * 6 + mChildren.size() * 2 + mNumbers.size() * 3);
+            out += sMagic;
+            WriteVarint(out, sFormatVersion);
+            WriteVarint(out, treeVersion);
+            const uint64_t hash{ mSource->ContentHash() };
+            for (size_t i = 0; i != sizeof(hash); i++)
+            {
+                out += static_cast<char>(hash >> (i * 8));
+            }
+            WriteVarint(out, text.size());
+            out += text;
+
+            // The Lexer interns straight out of the source, symbols that were copied elsewhere are still spelled somewhere in it
+            const size_t symbolCount{ mSymbols ? mSymbols->Size() : 0 };
+            WriteVarint(out, symbolCount);
+            for (SymbolId symbol = 0; symbol != symbolCount; symbol++)
+            {
+                const std::string_view spelling{ mSymbols->Spelling(symbol) };
+                const auto begin{ reinterpret_cast<uintptr_t>(text.data()) };
+                const auto position{ reinterpret_cast<uintptr_t>(spelling.data()) };
+                const size_t offset{ position >= begin && position + spelling.size() <= begin + text.size() ? position - begin : text.find(spelling) };
+                assert(offset != std::string_view::npos);
+                WriteVarint(out, offset);
+                WriteVarint(out, spelling.size());
+            }
+
+            WriteVarint(out, mNumbers.size());
+            for (const Number number : mNumbers)
+            {
+                WriteVarint(out, ZigZag(number));
+            }
+
+            WriteVarint(out, mNodes.size());
+            int64_t previousOffset{ 0 };
+            for (NodeIndex node = 0; node != mNodes.size(); node++)
+            {
+                const FlatNode& flatNode{ mNodes[node] };
+                WriteVarint(out, static_cast<uint8_t>(flatNode.mKind));
+                WriteVarint(out, static_cast<uint8_t>(flatNode.mTokenType));
+                WriteVarint(out, ZigZag(static_cast<int64_t>(flatNode.mOffset) - previousOffset));
+                previousOffset = flatNode.mOffset;
+                WriteVarint(out, flatNode.mLength);
+
+                if (IsLeaf(flatNode.mKind))
+                {
+                    // Identifiers are shifted by one so sNoSymbol stays a single byte
+                    WriteVarint(out, flatNode.mKind == FlatNodeKind::IdentifierExpression ? static_cast<uint32_t>(flatNode.mPayload + 1) : flatNode.mPayload);
+                    continue;
+                }
+
+                WriteVarint(out, flatNode.mChildCount);
+                for (const NodeIndex child : GetChildren(node))
+                {
+                    WriteVarint(out, child == sNoNode ? 0 : node - child);
+                }
+            }
+
+            WriteVarint(out, mStatements.size());
+            for (const NodeIndex statement : mStatements)
+            {
+                WriteVarint(out, statement);
+            }
+
+            return out;
+        }
+
+        std::optional<FlatProgram> FlatProgram::Deserialize(std::string_view bytes, SourceBufferSharedPtr source, uint64_t treeVersion /*= 0*/)
+        {
+            if (!source || !bytes.starts_with(sMagic))
+            {
+                return std::nullopt;
+            }
+
+            ByteReader reader{ bytes.substr(sMagic.size()) };
+            if (reader.ReadVarint() != sFormatVersion || reader.ReadVarint() != treeVersion || reader.ReadFixed64() != source->ContentHash() ||
+                reader.ReadVarint() != source->Size() || reader.ReadBytes(source->Size()) != source->View() || reader.Failed())
+            {
+                return std::nullopt;
+            }
+
+            FlatProgram program;
+            program.mSource = std::move(source);
+            program.mSymbols = std::make_shared<SymbolTable>();
+            const std::string_view text{ program.mSource->View() };
+
+            // Interning in id order hands out the same ids again
+            const uint32_t symbolCount{ reader.ReadCount() };
+            for (SymbolId symbol = 0; symbol != symbolCount; symbol++)
+            {
+                const uint32_t offset{ reader.ReadIndex(text.size() + 1) };
+                const uint32_t length{ reader.ReadIndex(text.size() - offset + 1) };
+                if (reader.Failed() || program.mSymbols->Intern(text.substr(offset, length)) != symbol)
+                {
+                    return std::nullopt;
+                }
+            }
+
+            const uint32_t numberCount{ reader.ReadCount() };
+            program.mNumbers.reserve(numberCount);
+            for (uint32_t i = 0; i != numberCount; i++)
+            {
+                program.mNumbers.push_back(UnZigZag(reader.ReadVarint()));
+            }
+
+            const uint32_t nodeCount{ reader.ReadCount() };
+            program.mNodes.reserve(nodeCount);
+            // Each node hangs off one parent at most, so what comes back is a tree and not a graph
+            std::vector<bool> hasParent(nodeCount);
+            const auto Adopt = [&hasParent](NodeIndex node)
+            {
+                if (hasParent[node])
+                {
+                    return false;
+                }
+                hasParent[node] = true;
+                return true;
+            };
+            int64_t previousOffset{ 0 };
+            for (NodeIndex node = 0; node != nodeCount; node++)
+            {
+                FlatNode flatNode{};
+                flatNode.mKind = static_cast<FlatNodeKind>(reader.ReadIndex(sFlatNodeKindCount));
+                flatNode.mTokenType = static_cast<TokenType>(reader.ReadIndex(sTokenTypeCount));
+                const int64_t offset{ previousOffset + UnZigZag(reader.ReadVarint()) };
+                if (offset < 0 || offset > static_cast<int64_t>(text.size()))
+                {
+                    return std::nullopt;
+                }
+                previousOffset = offset;
+                flatNode.mOffset = utility::narrow_cast<uint32_t>(offset);
+                flatNode.mLength = reader.ReadIndex(text.size() - flatNode.mOffset + 1);
+
+                switch (flatNode.mKind)
+                {
+                case FlatNodeKind::IdentifierExpression:
+                    flatNode.mPayload = reader.ReadIndex(static_cast<uint64_t>(symbolCount) + 1) - 1;
+                    break;
+                case FlatNodeKind::IntegerExpression:
+                    flatNode.mPayload = reader.ReadIndex(numberCount);
+                    break;
+                case FlatNodeKind::BooleanExpression:
+                    flatNode.mPayload = reader.ReadIndex(2);
+                    break;
+                default:
+                    flatNode.mChildCount = reader.ReadCount();
+                    flatNode.mPayload = utility::narrow_cast<uint32_t>(program.mChildren.size());
+                    if (!IsValidChildCount(flatNode.mKind, flatNode.mChildCount))
+                    {
+                        return std::nullopt;
+                    }
+                    for (uint32_t i = 0; i != flatNode.mChildCount; i++)
+                    {
+                        const uint32_t distance{ reader.ReadIndex(static_cast<uint64_t>(node) + 1) };
+                        const NodeIndex child{ distance == 0 ? sNoNode : node - distance };
+                        if (reader.Failed() || !IsValidChild(flatNode.mKind, i, flatNode.mChildCount, child == sNoNode ? nullptr : &program.mNodes[child]) ||
+                            (child != sNoNode && !Adopt(child)))
+                        {
+                            return std::nullopt;
+                        }
+                        program.mChildren.push_back(child);
+                    }
+                    break;
+                }
+
+                if (reader.Failed() || (IsLeaf(flatNode.mKind) && !IsValidLeaf(flatNode)))
+                {
+                    return std::nullopt;
+                }
+                program.mNodes.push_back(flatNode);
+            }
+
+            const uint32_t statementCount{ reader.ReadCount() };
+            program.mStatements.reserve(statementCount);
+            for (uint32_t i = 0; i != statementCount; i++)
+            {
+                const NodeIndex statement{ reader.ReadIndex(nodeCount) };
+                if (reader.Failed() || !IsStatement(program.mNodes[statement].mKind) || !Adopt(statement))
+                {
+                    return std::nullopt;
+                }
+                program.mStatements.push_back(statement);
+            }
+
+            if (reader.Failed() || !reader.AtEnd())
+            {
+                return std::nullopt;
+            }
+            return program;
+        }
+
+        // ------------------------------------------------------------ Access -----------------------------------------------------
+
+        std::span<const NodeIndex> FlatProgram::GetChildren(NodeIndex node) const
+        {
+            const FlatNode& flatNode{ mNodes[node] };
+            if (flatNode.mChildCount == 0)
+            {
+                return {};
+            }
+            return { mChildren.data() + flatNode.mPayload, flatNode.mChildCount };
+        }
+
+        std::string_view FlatProgram::Text(NodeIndex node) const
+        {
+            const FlatNode& flatNode{ mNodes[node] };
+            return flatNode.mTokenType == TokenType::ELSE_IF ? sElseIfLiteral : mSource->View().substr(flatNode.mOffset, flatNode.mLength);
+        }
+
+        Number FlatProgram::GetNumber(NodeIndex node) const
+        {
+            assert(mNodes[node].mKind == FlatNodeKind::IntegerExpression);
+            return mNumbers[mNodes[node].mPayload];
+        }
+
+        bool FlatProgram::GetBool(NodeIndex node) const
+        {
+            assert(mNodes[node].mKind == FlatNodeKind::BooleanExpression);
+            return mNodes[node].mPayload != 0;
+        }
+
+        SymbolId FlatProgram::GetSymbol(NodeIndex node) const
+        {
+            assert(mNodes[node].mKind == FlatNodeKind::IdentifierExpression);
+            return mNodes[node].mPayload;
+        }
+
+        Token FlatProgram::GetToken(NodeIndex node) const
+        {
+            const FlatNode& flatNode{ mNodes[node] };
+            Token token{ flatNode.mTokenType };
+            switch (flatNode.mKind)
+            {
+            case FlatNodeKind::IntegerExpression:
+                utility::AssignToToken(token, flatNode.mTokenType, GetNumber(node));
+                break;
+            case FlatNodeKind::BooleanExpression:
+                utility::AssignToToken(token, flatNode.mTokenType, GetBool(node));
+                break;
+            case FlatNodeKind::IdentifierExpression:
+                utility::AssignToToken(token, flatNode.mTokenType, Text(node));
+                token.mSymbol = GetSymbol(node);
+                break;
+            default:
+                utility::AssignToToken(token, flatNode.mTokenType, Text(node));
+                break;
+            }
+            token.mOffset = flatNode.mOffset;
+            token.mLength = flatNode.mLength;
+            return token;
+        }
+
+        size_t FlatProgram::MemoryUsage() const
+        {
+            return mNodes.capacity() * sizeof(FlatNode) + mChildren.capacity() * sizeof(NodeIndex) +
+                mNumbers.capacity() * sizeof(Number) + mStatements.capacity() * sizeof(NodeIndex);
+        }
+
+        // ------------------------------------------------------------ Log -----------------------------------------------------
+
+        void FlatProgram::AppendTokenText(std::string& out, NodeIndex node) const
+        {
+            switch (mNodes[node].mKind)
+            {
+            case FlatNodeKind::IntegerExpression:
+                out += std::to_string(GetNumber(node));
+                break;
+            case FlatNodeKind::BooleanExpression:
+                out += GetBool(node) ? "true" : "false";
+                break;
+            default:
+                out += Text(node);
+                break;
+            }
+        }
+
+        std::string FlatProgram::Log() const
+        {
+            // Written front to back off an explicit stack, a chain of operators is as deep as the input and every node is visited once.
+            // A part is either a node still to be written, the token text of a node, or plain text.
+            struct TokenText
+            {
+                NodeIndex mNode;
+            };
+            typedef std::variant<NodeIndex, TokenText, std::string_view> LogPart;
+            std::vector<LogPart> parts;
+            std::vector<LogPart> expanded;
+            const auto AppendList = [&expanded](std::span<const NodeIndex> children)
+            {
+                for (size_t i = 0; i != children.size(); i++)
+                {
+                    if (children[i] != sNoNode)
+                    {
+                        expanded.push_back(children[i]);
+                        if (i != children.size() - 1)
+                        {
+                            expanded.push_back(std::string_view{ ", " });
+                        }
+                    }
+                }
+            };
+
+            std::string result;
+            for (auto statement = mStatements.rbegin(); statement != mStatements.rend(); statement++)
+            {
+                parts.push_back(std::string_view{ "\n" });
+                parts.push_back(*statement);
+            }
+
+            while (!parts.empty())
+            {
+                const LogPart part{ parts.back() };
+                parts.pop_back();
+                if (const auto text{ std::get_if<std::string_view>(&part) })
+                {
+                    result += *text;
+                    continue;
+                }
+                if (const auto tokenText{ std::get_if<TokenText>(&part) })
+                {
+                    AppendTokenText(result, tokenText->mNode);
+                    continue;
+                }
+
+                const NodeIndex node{ std::get<NodeIndex>(part) };
+                if (node == sNoNode)
+                {
+                    continue;
+                }
+                const std::span<const NodeIndex> children{ GetChildren(node) };
+                expanded.clear();
+
+                switch (mNodes[node].mKind)
+                {
+                case FlatNodeKind::LetStatement:
+                    expanded.insert(expanded.end(), { TokenText{ node }, std::string_view{ " " }, children[0], std::string_view{ " = " }, children[1], std::string_view{ ";" } });
+                    break;
+                case FlatNodeKind::ReturnStatement:
+                    expanded.insert(expanded.end(), { TokenText{ node }, std::string_view{ " " }, children[0], std::string_view{ ";" } });
+                    break;
+                case FlatNodeKind::ExpressionStatement:
+                    expanded.push_back(children[0]);
+                    break;
+                case FlatNodeKind::BlockStatement:
+                    expanded.push_back(std::string_view{ "{ " });
+                    expanded.insert(expanded.end(), children.begin(), children.end());
+                    expanded.push_back(std::string_view{ " }" });
+                    break;
+                case FlatNodeKind::ConditionBlockStatement:
+                    assert(children[0] != sNoNode);
+                    expanded.insert(expanded.end(), { TokenText{ node }, children[0], children[1] });
+                    break;
+                case FlatNodeKind::IdentifierExpression:
+                case FlatNodeKind::IntegerExpression:
+                case FlatNodeKind::BooleanExpression:
+                    AppendTokenText(result, node);
+                    break;
+                case FlatNodeKind::PrefixExpression:
+                    expanded.insert(expanded.end(), { std::string_view{ "(" }, TokenText{ node }, children[0], std::string_view{ ")" } });
+                    break;
+                case FlatNodeKind::InfixExpression:
+                    expanded.insert(expanded.end(), { std::string_view{ "(" }, children[0], std::string_view{ " " }, TokenText{ node }, std::string_view{ " " }, children[1], std::string_view{ ")" } });
+                    break;
+                case FlatNodeKind::IfExpression:
+                    expanded.insert(expanded.end(), children.begin(), children.end() - 1);
+                    expanded.push_back(std::string_view{ " " });
+                    if (children.back() != sNoNode)
+                    {
+                        expanded.insert(expanded.end(), { std::string_view{ " else " }, children.back() });
+                    }
+                    break;
+                case FlatNodeKind::FunctionExpression:
+                    expanded.insert(expanded.end(), { TokenText{ node }, std::string_view{ "(" } });
+                    AppendList(children.subspan(1));
+                    expanded.insert(expanded.end(), { std::string_view{ ") " }, children[0] });
+                    break;
+                case FlatNodeKind::CallExpression:
+                    expanded.insert(expanded.end(), { children[0], std::string_view{ "(" } });
+                    AppendList(children.subspan(1));
+                    expanded.push_back(std::string_view{ ")" });
+                    break;
+                }
+
+                // Back to front, so the parts come off the stack in order
+                parts.insert(parts.end(), expanded.rbegin(), expanded.rend());
+            }
+            return result;
+        }
+    }
+}
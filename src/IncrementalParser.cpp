@@ -0,0 +1,257 @@
+#include "IncrementalParser.h"
+#include "Parser.h"
+#include "Lexer.h"
+#include "SourceBuffer.h"
+#include "SymbolTable.h"
+#include "ProgramArena.h"
+#include "Utility.h"
+#include <algorithm>
+
+namespace interpreter
+{
+    IncrementalParser::IncrementalParser(SourceBufferSharedPtr source) :
+        mText(source->View()),
+        mSource(std::move(source)),
+        mSymbols(std::make_shared<SymbolTable>()),
+        mShiftFrom(0),
+        mShift(0),
+        mLastReparsedRanges(0),
+        mStatementsChanged(true)
+    {
+        Rebuild();
+    }
+
+    // ------------------------------------------------------------ Editing -----------------------------------------------------
+
+    void IncrementalParser::Edit(size_t offset, size_t removedLength, std::string_view insertedText)
+    {
+        VERIFY(offset <= mText.size() && removedLength <= mText.size() - offset)
+        {
+            mText.replace(offset, removedLength, insertedText);
+            mSource.reset();
+
+            // Ranges the edit touches, in the old offsets. Text typed right against a token can merge with it, so touching counts.
+            const uint32_t editBegin{ utility::narrow_cast<uint32_t>(offset) };
+            const uint32_t editEnd{ utility::narrow_cast<uint32_t>(offset + removedLength) };
+            const int32_t shift{ utility::narrow_cast<int32_t>(static_cast<int64_t>(insertedText.size()) - static_cast<int64_t>(removedLength)) };
+            const auto IndexOf = [this](const StatementRange& range) { return static_cast<size_t>(&range - mRanges.data()); };
+            size_t first{ static_cast<size_t>(std::partition_point(mRanges.begin(), mRanges.end(), [&](const StatementRange& range) { return RangeEnd(IndexOf(range)) < editBegin; }) - mRanges.begin()) };
+            size_t last{ static_cast<size_t>(std::partition_point(mRanges.begin(), mRanges.end(), [&](const StatementRange& range) { return RangeBegin(IndexOf(range)) <= editEnd; }) - mRanges.begin()) };
+            // Anything written after an unterminated last range continues it
+            if (first > 0 && !mRanges[first - 1].mTerminated)
+            {
+                first--;
+            }
+            MoveShift(last);
+
+            const uint32_t regionBegin{ first < last ? std::min(editBegin, mRanges[first].mBegin) : editBegin };
+            uint32_t regionEnd{ first < last ? std::max(editEnd, mRanges[last - 1].mEnd) : editEnd };
+
+            // The edit can open a block or drop a ";", then the region swallows the following ranges until it lines up again.
+            // Taking twice as many each time keeps an edit that unsettles the rest of the source linear.
+            std::optional<std::vector<StatementRange>> reparsed;
+            size_t extension{ 1 };
+            while (true)
+            {
+                const bool reachesEnd{ last == mRanges.size() };
+                const uint32_t end{ reachesEnd ? utility::narrow_cast<uint32_t>(mText.size()) : static_cast<uint32_t>(regionEnd + shift) };
+                reparsed = ParseRegion(regionBegin, end, reachesEnd, mEditArena);
+                if (reparsed)
+                {
+                    break;
+                }
+                last += std::min(extension, mRanges.size() - last);
+                MoveShift(last);
+                regionEnd = mRanges[last - 1].mEnd;
+                extension *= 2;
+            }
+            mShift += shift;
+
+            mLastReparsedRanges = reparsed->size();
+            if (reparsed->size() == last - first)
+            {
+                std::move(reparsed->begin(), reparsed->end(), mRanges.begin() + first);
+            }
+            else
+            {
+                mRanges.erase(mRanges.begin() + first, mRanges.begin() + last);
+                mRanges.insert(mRanges.begin() + first, std::make_move_iterator(reparsed->begin()), std::make_move_iterator(reparsed->end()));
+            }
+            mShiftFrom = first + reparsed->size();
+            mStatementsChanged = true;
+
+            // Replaced statements stay in the edit arena until the next full parse, once they outweigh the tree it's time for one
+            if (mEditArena->BytesAllocated() > std::max(mProgram->mArena->BytesAllocated(), ProgramArena::sDefaultBlockSize))
+            {
+                Rebuild();
+            }
+        }
+    }
+
+    ast::Program& IncrementalParser::GetProgram()
+    {
+        if (mStatementsChanged)
+        {
+            mProgram->mStatements.clear();
+            mProgram->mStatementOffsets.clear();
+            for (size_t range = 0; range != mRanges.size(); range++)
+            {
+                const std::vector<StatementPtr>& statements{ mRanges[range].mStatements };
+                mProgram->mStatements.insert(mProgram->mStatements.end(), statements.begin(), statements.end());
+                mProgram->mStatementOffsets.insert(mProgram->mStatementOffsets.end(), statements.size(), RangeBegin(range) - mRanges[range].mTextOffset);
+            }
+            mProgram->mSource = GetSource();
+            mStatementsChanged = false;
+        }
+
+        return *mProgram;
+    }
+
+    const SourceBufferSharedPtr& IncrementalParser::GetSource()
+    {
+        if (!mSource)
+        {
+            mSource = SourceBuffer::FromString(mText);
+        }
+        return mSource;
+    }
+
+    Diagnostics IncrementalParser::GetDiagnostics() const
+    {
+        // Ranges cover every token, so a range's first token index is the number of tokens in the ranges before it
+        Diagnostics diagnostics;
+        uint32_t tokenIndex{};
+        for (size_t range = 0; range != mRanges.size(); range++)
+        {
+            for (Diagnostic diagnostic : mRanges[range].mDiagnostics)
+            {
+                diagnostic.mOffset += RangeBegin(range);
+                diagnostic.mTokenIndex += tokenIndex;
+                diagnostics.Report(diagnostic);
+            }
+            tokenIndex += mRanges[range].mTokenCount;
+        }
+        return diagnostics;
+    }
+
+    // ------------------------------------------------------------ Parsing -----------------------------------------------------
+
+    std::optional<std::vector<IncrementalParser::StatementRange>> IncrementalParser::ParseRegion(uint32_t begin, uint32_t end, bool allowUnterminated, ProgramArenaUniquePtr& arena)
+    {
+        std::vector<StatementRange> ranges;
+        if (begin == end)
+        {
+            return ranges;
+        }
+
+        // The region gets a buffer of its own so the tokens don't pin down the whole source of every edit. Its offsets start at 0
+        // and stay that way, the ranges remember where they are in it.
+        const SourceBufferSharedPtr text{ begin == 0 && end == mText.size() ? GetSource() : SourceBuffer::FromString(mText.substr(begin, end - begin)) };
+
+        // It's lexed against a table of its own too. The shared table only keeps views, so spellings it hasn't seen yet are
+        // copied out of the region first, the table outlives every region buffer.
+        LexerUniquePtr lexer{ new Lexer(text, LexerMode::TOKENIZE, text->Data(), text->Data() + text->Size()) };
+        lexer->Tokenize();
+        std::vector<SymbolId> symbolRemap;
+        symbolRemap.reserve(lexer->mSymbols->Size());
+        for (SymbolId symbol = 0; symbol < lexer->mSymbols->Size(); symbol++)
+        {
+            const std::string_view spelling{ lexer->mSymbols->Spelling(symbol) };
+            const std::optional<SymbolId> known{ mSymbols->Find(spelling) };
+            symbolRemap.push_back(known ? *known : mSymbols->Intern(mSymbolSpellings.emplace_back(spelling)));
+        }
+        TokenStream tokens{ text };
+        tokens.Reserve(lexer->mTokens.Size());
+        tokens.Append(lexer->mTokens, symbolRemap);
+        tokens.Push(lexer->mTokens.Get(lexer->mTokens.Size() - 1));
+        lexer->mTokens = std::move(tokens);
+        lexer->mSymbols = mSymbols;
+
+        // The region can only be cut after a statement that ended on a ";" without peeking past it, the parser starts the next
+        // one from a clean slate there. Anything after the last such ";" isn't settled yet.
+        std::vector<uint32_t> statementEnds;
+        Parser parser{ std::move(lexer) };
+        parser.mStatementEnds = &statementEnds;
+        ProgramUniquePtr program{ parser.ParseProgram(std::move(arena)) };
+        arena = std::move(program->mArena);
+
+        const TokenStream& regionTokens{ parser.mLexer->mTokens };
+        const size_t endToken{ regionTokens.Size() - 1 };
+        std::vector<size_t> firstTokens;
+        size_t first{};
+        for (const uint32_t last : statementEnds)
+        {
+            if (last < endToken && regionTokens.Type(last) == TokenType::SEMICOLON)
+            {
+                ranges.push_back({ regionTokens.Offset(first), regionTokens.Offset(last) + regionTokens.Length(last), utility::narrow_cast<uint32_t>(last + 1 - first), regionTokens.Offset(first), true, text });
+                firstTokens.push_back(first);
+                first = last + 1;
+            }
+        }
+
+        if (first < endToken)
+        {
+            if (!allowUnterminated)
+            {
+                return std::nullopt;
+            }
+            ranges.push_back({ regionTokens.Offset(first), regionTokens.Offset(endToken - 1) + regionTokens.Length(endToken - 1), utility::narrow_cast<uint32_t>(endToken - first), regionTokens.Offset(first), false, text });
+            firstTokens.push_back(first);
+        }
+
+        size_t range{};
+        for (StatementPtr statement : program->mStatements)
+        {
+            while (range + 1 < ranges.size() && statement->TokenNode().mOffset >= ranges[range].mEnd)
+            {
+                range++;
+            }
+            ranges[range].mStatements.push_back(statement);
+        }
+
+        for (Diagnostic diagnostic : parser.GetDiagnostics().GetDiagnostics())
+        {
+            const size_t owner{ static_cast<size_t>(std::upper_bound(firstTokens.begin(), firstTokens.end(), diagnostic.mTokenIndex) - firstTokens.begin()) - 1 };
+            diagnostic.mOffset -= ranges[owner].mBegin;
+            diagnostic.mTokenIndex -= utility::narrow_cast<uint32_t>(firstTokens[owner]);
+            ranges[owner].mDiagnostics.push_back(diagnostic);
+        }
+
+        for (StatementRange& range : ranges)
+        {
+            range.mBegin += begin;
+            range.mEnd += begin;
+        }
+        return ranges;
+    }
+
+    void IncrementalParser::Rebuild()
+    {
+        mProgram = std::make_unique<ast::Program>();
+        mProgram->mSource = GetSource();
+        mProgram->mSymbols = mSymbols;
+        mEditArena = std::make_unique<ProgramArena>();
+        mRanges = std::move(*ParseRegion(0, utility::narrow_cast<uint32_t>(mText.size()), true, mProgram->mArena));
+        mShiftFrom = 0;
+        mShift = 0;
+        mStatementsChanged = true;
+    }
+
+    void IncrementalParser::MoveShift(size_t shiftFrom)
+    {
+        if (mShift != 0)
+        {
+            for (size_t range = mShiftFrom; range < shiftFrom; range++)
+            {
+                mRanges[range].mBegin += mShift;
+                mRanges[range].mEnd += mShift;
+            }
+            for (size_t range = shiftFrom; range < mShiftFrom; range++)
+            {
+                mRanges[range].mBegin -= mShift;
+                mRanges[range].mEnd -= mShift;
+            }
+        }
+        mShiftFrom = shiftFrom;
+    }
+}
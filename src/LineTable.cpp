@@ -0,0 +1,26 @@
+#include "LineTable.h"
+#include "CharacterScanner.h"
+#include "Utility.h"
+#include <algorithm>
+
+namespace interpreter
+{
+    LineTable::LineTable(std::string_view source)
+    {
+        mLineStarts.push_back(0);
+
+        const char* begin{ source.data() };
+        const char* end{ begin + source.size() };
+        for (const char* newLine = scanner::FindNewLine(begin, end); newLine != end; newLine = scanner::FindNewLine(newLine + 1, end))
+        {
+            mLineStarts.push_back(utility::narrow_cast<uint32_t>(newLine + 1 - begin));
+        }
+    }
+
+    SourceLocation LineTable::Locate(uint32_t offset) const
+    {
+        // Last line that starts at or before the offset, the first line always starts at 0
+        const auto lineIter{ std::prev(std::upper_bound(mLineStarts.begin(), mLineStarts.end(), offset)) };
+        return { static_cast<uint32_t>(lineIter - mLineStarts.begin()), offset - *lineIter };
+    }
+}
@@ -1,8 +1,11 @@
 #include "Logger.h"
+#include "OutputBuffer.h"
+#include "Objects.h"
 #include <memory>
 #include <time.h>
 #include <format>
 #include <chrono>
+#include <mutex>
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -70,6 +73,9 @@ namespace interpreter
 
     void Logger::Log(MessageType type, std::string_view message)
     {
+        // The parallel lexer reports from its worker threads
+        static std::mutex sLogMutex;
+        std::lock_guard lock{ sLogMutex };
         std::cout << MessageString(type) << message << '\n';
 
         FileLogger().mData.emplace_back(type, message);
@@ -115,12 +121,24 @@ namespace interpreter
 
     void LOG_MESSAGE(ast::Node* node, MessageType type /*= MessageType::MESSAGE*/)
     {
-        Logger::Log(type, node->Log());
+        // Every call on a thread reuses the same buffer, logging a big tree doesn't allocate once it has grown to fit
+        thread_local OutputBuffer sOutput;
+        sOutput.Clear();
+        node->Log(sOutput);
+        Logger::Log(type, sOutput.View());
     }
 
     void LOG_MESSAGE(std::unique_ptr<ast::Node>& node, MessageType type /*= MessageType::MESSAGE*/)
     {
-        Logger::Log(type, node->Log());
+        LOG_MESSAGE(node.get(), type);
+    }
+
+    void LOG_MESSAGE(const Object& object, MessageType type /*= MessageType::MESSAGE*/)
+    {
+        thread_local OutputBuffer sOutput;
+        sOutput.Clear();
+        object.Inspect(sOutput);
+        Logger::Log(type, sOutput.View());
     }
 
     void LOG_MESSAGE(MessageType type, std::string_view message)
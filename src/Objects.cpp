@@ -1,53 +1,50 @@
 #include "Objects.h"
 #include "Utility.h"
-#include <sstream>
+#include "OutputBuffer.h"
+#include "AbstractSyntaxTree.h"
 
 namespace interpreter
 {
+    std::string Object::Inspect() const
+    {
+        OutputBuffer out;
+        Inspect(out);
+        return out.Release();
+    }
 
     // ------------------------------------------------------------ Integer Type -----------------------------------------------------
 
-    ObjectType IntegerType::Type() const
-    {
-        return "int";
-    };
-
-    std::string IntegerType::Inspect() const
+    void IntegerType::Inspect(OutputBuffer& out) const
     {
-        std::ostringstream out;
-        out << mValue;
-        return out.str();
+        out.Append(mValue);
     };
 
     // ------------------------------------------------------------ Bool Type -----------------------------------------------------
 
-    ObjectType BoolType::Type() const
+    void BoolType::Inspect(OutputBuffer& out) const
     {
-        return "bool";
+        out.Append(mValue ? "true" : "false");
     };
 
-    std::string BoolType::Inspect() const
-    {
-        if (mValue)
-        {
-            return "true";
-        }
+    // ------------------------------------------------------------ Null Type -----------------------------------------------------
 
-        return "false";
+    void NullType::Inspect(OutputBuffer& out) const
+    {
+        out.Append("nullptr");
     };
 
-    // ------------------------------------------------------------ Null Type -----------------------------------------------------
+    // ------------------------------------------------------------ Function Type -----------------------------------------------------
 
-    ObjectType NullType::Type() const
+    void FunctionType::Inspect(OutputBuffer& out) const
     {
-        return "NULL";
+        mDefinition->Log(out);
     };
 
-    std::string NullType::Inspect() const
+    // ------------------------------------------------------------ Return Value Type -----------------------------------------------------
+
+    void ReturnValueType::Inspect(OutputBuffer& out) const
     {
-        return "nullptr";
+        mValue->Inspect(out);
     };
 
 }
-
-
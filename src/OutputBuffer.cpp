@@ -0,0 +1,33 @@
+#include "OutputBuffer.h"
+#include "Token.h"
+#include <charconv>
+#include <limits>
+
+namespace interpreter
+{
+    OutputBuffer& OutputBuffer::Append(Number number)
+    {
+        char digits[std::numeric_limits<Number>::digits10 + 3];   // Sign and the partial last digit
+        const auto [end, error] { std::to_chars(digits, digits + sizeof(digits), number) };
+        mBuffer.append(digits, end);
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::Append(const Token& token)
+    {
+        // The literal's type follows the TokenType, so this picks the same text operator<< does
+        if (const auto text{ std::get_if<std::string_view>(&token.mLiteral) })
+        {
+            mBuffer.append(*text);
+        }
+        else if (const auto number{ std::get_if<Number>(&token.mLiteral) })
+        {
+            Append(*number);
+        }
+        else if (const auto boolean{ std::get_if<bool>(&token.mLiteral) })
+        {
+            Append(*boolean ? "true" : "false");
+        }
+        return *this;
+    }
+}
@@ -1,69 +1,110 @@
 #include "Parser.h"
 #include "Logger.h"
-#include "Objects.h"
+#include "SourceBuffer.h"
 #include <format>
+#include <atomic>
+#include <thread>
 
 namespace interpreter
 {
-    Parser::Parser(LexerUniquePtr lexer) : mLexer(std::move(lexer))
+    Parser::Parser(LexerUniquePtr lexer) :
+        mOwnedLexer(std::move(lexer)),
+        mLexer(mOwnedLexer.get()),
+        mArena(nullptr),
+        mArenaTokens{},
+        mTokenIndices{},
+        mCurrent(0),
+        mBuffered(0),
+        mTokenIndex(0),
+        mTokenEnd(mLexer->mTokens.Size()),
+        mReachedEnd(false),
+        mRecoveredErrors(0),
+        mStatementEnds(nullptr)
     {
-        VERIFY(!mLexer->mTokens.empty())
-        {
-            mCurrent = mLexer->mTokens.begin();
-            mNext = mCurrent + 1;
-            mEnd = mLexer->mTokens.end();
+        assert(mLexer->GetMode() == LexerMode::STREAM || !mLexer->mTokens.Empty());
+    }
 
-            RegisterParseFunctionPointers();
-        }
+    Parser::Parser(Lexer& lexer, size_t tokenBegin, size_t tokenEnd) :
+        mLexer(&lexer),
+        mArena(nullptr),
+        mArenaTokens{},
+        mTokenIndices{},
+        mCurrent(0),
+        mBuffered(0),
+        mTokenIndex(tokenBegin),
+        mTokenEnd(tokenEnd),
+        mReachedEnd(false),
+        mRecoveredErrors(0),
+        mStatementEnds(nullptr)
+    {
+        assert(mLexer->GetMode() != LexerMode::STREAM && tokenBegin < tokenEnd && tokenEnd <= mLexer->mTokens.Size());
     }
 
-    void Parser::RegisterParseFunctionPointers()
+    bool Parser::FetchToken(Token& token)
     {
-        const auto RegisterPrefixFunctionPtr = [this](TokenType tokenType, PrefixParseFunctionPtr functionPtr) {
-            mPrefixFunctionPtrMap.insert_or_assign(tokenType, functionPtr);
-        };
+        if (mReachedEnd)
+        {
+            return false;
+        }
 
-        const auto RegisterInfixFunctionPtr = [this](TokenType tokenType, InfixParseFunctionPtr functionPtr) {
-            mInfixFunctionPtrMap.insert_or_assign(tokenType, functionPtr);
-        };
+        if (mLexer->GetMode() == LexerMode::STREAM)
+        {
+            token = mLexer->AdvanceToken();
+        }
+        else
+        {
+            if (mTokenIndex == mLexer->mTokens.Size())
+            {
+                mReachedEnd = true;
+                return false;
+            }
+
+            if (mTokenIndex == mTokenEnd)
+            {
+                // A statement range parsed on its own ends the way the whole program does
+                token = {};
+                utility::AssignToToken(token, TokenType::ENDF, std::string_view{});
+                token.mOffset = mLexer->mTokens.Offset(mTokenEnd);
+            }
+            else
+            {
+                // Only the tokens in the lookahead ring are ever materialized from the packed stream
+                token = mLexer->mTokens.Get(mTokenIndex);
+            }
+        }
+        ++mTokenIndex;
 
-        // Register Prefix Function pointers
-        RegisterPrefixFunctionPtr(TokenType::TRUE, std::bind(&Parser::ParsePrimitiveExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::FALSE, std::bind(&Parser::ParsePrimitiveExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::IDENT, std::bind(&Parser::ParsePrimitiveExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::INT, std::bind(&Parser::ParsePrimitiveExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::BANG, std::bind(&Parser::ParsePrefixExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::MINUS, std::bind(&Parser::ParsePrefixExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::LPAREN, std::bind(&Parser::ParseGroupedExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::IF, std::bind(&Parser::ParseIfExpression, this));
-        RegisterPrefixFunctionPtr(TokenType::FUNCTION, std::bind(&Parser::ParseFunctionExpression, this));
+        mReachedEnd = token.mType == TokenType::ENDF;
+        return true;
+    }
 
-        // Register Infix Function pointers
+    const Token* Parser::PeekToken(size_t distance)
+    {
+        assert(distance < sLookaheadCapacity);
+        while (mBuffered <= distance)
         {
-            using namespace std::placeholders;
-
-            RegisterInfixFunctionPtr(TokenType::PLUS, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::MINUS, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::SLASH, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::ASTERISK, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::EQ, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::NOT_EQ, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::LT, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::GT, std::bind(&Parser::ParseInfixExpression, this, _1));
-            RegisterInfixFunctionPtr(TokenType::LPAREN, std::bind(&Parser::ParseCallExpression, this, _1));
+            const size_t slotIndex{ (mCurrent + mBuffered) & (sLookaheadCapacity - 1) };
+            if (!FetchToken(mLookahead[slotIndex]))
+            {
+                return nullptr;
+            }
+            mArenaTokens[slotIndex] = nullptr;
+            mTokenIndices[slotIndex] = utility::narrow_cast<uint32_t>(mTokenIndex - 1);
+            ++mBuffered;
         }
 
+        return &mLookahead[(mCurrent + distance) & (sLookaheadCapacity - 1)];
     }
 
     void Parser::AdvanceToken()
     {
-        if (mNext == mEnd)
+        if (!PeekToken(1))
         {
             return;
         }
 
-        mCurrent = mNext;
-        mNext++;
+        mCurrent = (mCurrent + 1) & (sLookaheadCapacity - 1);
+        --mBuffered;
     }
 
     const Token* Parser::GetCurrentTokenAndAdvance()
@@ -75,22 +116,26 @@ namespace interpreter
 
     const Token* Parser::GetCurrentToken()
     {
-        if (mCurrent != mEnd)
+        return PeekToken(0);
+    }
+
+    const Token* Parser::GetCurrentArenaToken()
+    {
+        VERIFY(GetCurrentToken())
         {
-            return &(*mCurrent);
+            const Token*& arenaToken{ mArenaTokens[mCurrent] };
+            if (!arenaToken)
+            {
+                arenaToken = mArena->Create<Token>(mLookahead[mCurrent]);
+            }
+            return arenaToken;
         }
-
         return nullptr;
     }
 
     const Token* Parser::GetNextToken()
     {
-        if (mNext != mEnd)
-        {
-            return &(*mNext);
-        }
-
-        return nullptr;
+        return PeekToken(1);
     }
 
     std::tuple<const Token*, const Token*> Parser::GetTokens()
@@ -98,15 +143,24 @@ namespace interpreter
         return { GetCurrentToken(),GetNextToken() };
     }
 
-    ProgramUniquePtr Parser::ParseProgram()
+    ProgramUniquePtr Parser::ParseProgram(ProgramArenaUniquePtr arena /* = nullptr*/)
     {
-        auto program{ std::make_unique<ast::Program>() };
+        auto program{ std::make_unique<ast::Program>(std::move(arena)) };
+        mArena = program->mArena.get();
+        mArenaTokens.fill(nullptr);
+        program->mSource = mLexer->GetSource();
+        program->mSymbols = mLexer->GetSymbols();
         while (GetCurrentToken() && !CurrentTokenIs(TokenType::ENDF))
         {
-            StatementUniquePtr statement{ ParseStatement() };
+            StatementPtr statement{ ParseStatementAndRecover() };
             if (statement)
             {
-                program->mStatements.push_back(std::move(statement));
+                program->mStatements.push_back(statement);
+            }
+            // Statements that never looked past their last token, the next one starts from a clean slate there
+            if (mStatementEnds && mBuffered == 1)
+            {
+                mStatementEnds->push_back(mTokenIndices[mCurrent]);
             }
             AdvanceToken();
         }
@@ -114,7 +168,7 @@ namespace interpreter
         return program;
     }
 
-    StatementUniquePtr Parser::ParseStatement()
+    StatementPtr Parser::ParseStatement()
     {
         const Token* token{ GetCurrentToken() };
         VERIFY(token)
@@ -135,11 +189,181 @@ namespace interpreter
         return nullptr;
     }
 
-    LetStatementUniquePtr Parser::ParseLetStatement()
+    ProgramUniquePtr Parser::ParseProgramParallel(size_t statementsPerTask /* = sDefaultStatementsPerTask*/)
     {
-        auto statement{ std::make_unique<ast::LetStatement>() };
+        // Streaming never has the whole token stream to split
+        if (mLexer->GetMode() == LexerMode::STREAM || mTokenIndex != 0)
+        {
+            return ParseProgram();
+        }
+
+        const std::vector<size_t> boundaries{ FindStatementBoundaries(statementsPerTask) };
+        if (boundaries.size() < 3)
+        {
+            return ParseProgram();
+        }
+
+        // Ranges are handed out to one worker per hardware thread, each worker parses all of its ranges into its own arena.
+        struct RangeResult
+        {
+            std::vector<StatementPtr> mStatements;
+            Diagnostics mDiagnostics;
+        };
+        const size_t rangeCount{ boundaries.size() - 1 };
+        std::vector<RangeResult> results(rangeCount);
+        const size_t workerCount{ std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), rangeCount) };
+        std::vector<ProgramArenaUniquePtr> arenas(workerCount);
+
+        std::atomic<size_t> nextRange{ 0 };
+        const auto ParseRanges = [&](size_t worker)
+        {
+            ProgramArenaUniquePtr arena;
+            for (size_t range = nextRange++; range < rangeCount; range = nextRange++)
+            {
+                Parser rangeParser{ *mLexer, boundaries[range], boundaries[range + 1] };
+                ProgramUniquePtr rangeProgram{ rangeParser.ParseProgram(std::move(arena)) };
+                arena = std::move(rangeProgram->mArena);
+                results[range].mStatements = std::move(rangeProgram->mStatements);
+                results[range].mDiagnostics = std::move(rangeParser.mDiagnostics);
+            }
+            arenas[worker] = std::move(arena);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t worker = 1; worker < workerCount; worker++)
+        {
+            workers.emplace_back(ParseRanges, worker);
+        }
+        ParseRanges(0);
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        // Splice the ranges back together in source order. Token indices in the diagnostics are already absolute.
+        auto program{ std::make_unique<ast::Program>(std::move(arenas[0])) };
+        program->mSource = mLexer->GetSource();
+        program->mSymbols = mLexer->GetSymbols();
+        for (size_t worker = 1; worker != arenas.size(); worker++)
+        {
+            if (arenas[worker])
+            {
+                program->mSplicedArenas.push_back(std::move(arenas[worker]));
+            }
+        }
+
+        size_t statementCount{};
+        for (const RangeResult& result : results)
+        {
+            statementCount += result.mStatements.size();
+        }
+        program->mStatements.reserve(statementCount);
+        for (const RangeResult& result : results)
+        {
+            program->mStatements.insert(program->mStatements.end(), result.mStatements.begin(), result.mStatements.end());
+            mDiagnostics.Append(result.mDiagnostics);
+        }
+
+        // Leave the parser the way the sequential parse would, at the end of the stream
+        mTokenIndex = mTokenEnd;
+        mBuffered = 0;
+        mReachedEnd = true;
+
+        return program;
+    }
+
+    std::vector<size_t> Parser::FindStatementBoundaries(size_t statementsPerTask) const
+    {
+        // A ";" outside of any braces or parentheses always ends a statement, every statementsPerTask of them we start a new range.
+        // Unbalanced input never gets back to depth 0 and simply stays in one range.
+        const TokenStream& tokens{ mLexer->mTokens };
+        std::vector<size_t> boundaries{ 0 };
+        ptrdiff_t depth{};
+        size_t statements{};
+        for (size_t index = 0; index + 1 < tokens.Size(); index++)
+        {
+            switch (tokens.Type(index))
+            {
+            case TokenType::LPAREN:
+            case TokenType::LBRACE:
+                depth++;
+                break;
+            case TokenType::RPAREN:
+            case TokenType::RBRACE:
+                depth--;
+                break;
+            case TokenType::SEMICOLON:
+                if (depth == 0 && ++statements == statementsPerTask)
+                {
+                    boundaries.push_back(index + 1);
+                    statements = 0;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        // The last range runs up to and including the real ENDF
+        if (boundaries.back() == tokens.Size() - 1)
+        {
+            boundaries.pop_back();
+        }
+        boundaries.push_back(tokens.Size());
+        return boundaries;
+    }
+
+    StatementPtr Parser::ParseStatementAndRecover()
+    {
+        const size_t errors{ mDiagnostics.Count() };
+        const size_t recoveredErrors{ mRecoveredErrors };
+        StatementPtr statement{ ParseStatement() };
+        // Errors in a nested block have already been recovered from inside the block, the statement around it is fine.
+        // Only the nested block's own errors count as recovered, not ones the statement reported before getting there.
+        if (mDiagnostics.Count() - errors != mRecoveredErrors - recoveredErrors)
+        {
+            Synchronize();
+            mRecoveredErrors = recoveredErrors + (mDiagnostics.Count() - errors);
+            return nullptr;
+        }
+        return statement;
+    }
+
+    void Parser::Synchronize()
+    {
+        // Panic mode: skip the rest of the broken statement so the errors don't cascade into the next one.
+        // We stop on its ";", or right before a "}" that closes the enclosing block, the callers advance past the statement.
+        size_t depth{};
+        while (const Token* token{ GetCurrentToken() })
+        {
+            if (token->mType == TokenType::LBRACE)
+            {
+                depth++;
+            }
+            else if (token->mType == TokenType::RBRACE && depth)
+            {
+                depth--;
+            }
+
+            if (token->mType == TokenType::ENDF || (!depth && token->mType == TokenType::SEMICOLON))
+            {
+                return;
+            }
+
+            const Token* nextToken{ GetNextToken() };
+            if (!nextToken || nextToken->mType == TokenType::ENDF || (!depth && nextToken->mType == TokenType::RBRACE))
+            {
+                return;
+            }
+            AdvanceToken();
+        }
+    }
+
+    LetStatementPtr Parser::ParseLetStatement()
+    {
+        auto statement{ mArena->Create<ast::LetStatement>() };
         // We only land here after checking the CurrentToken in ParseStatement so it is safe to dereference without checking here 
-        statement->mToken = *GetCurrentToken(); // "let" token
+        statement->mToken = GetCurrentArenaToken(); // "let" token
 
         if (!ExpectNextTokenIs(TokenType::IDENT))
         {
@@ -149,7 +373,7 @@ namespace interpreter
         VERIFY(GetNextToken())
         {
             AdvanceToken();
-            statement->mIdentifier = std::move(ParsePrimitiveExpression()); // Identifier
+            statement->mIdentifier = ParsePrimitiveExpression(); // Identifier
         }
 
         if (!ExpectNextTokenIs(TokenType::ASSIGN))
@@ -169,11 +393,11 @@ namespace interpreter
         return statement;
     }
 
-    ReturnStatementUniquePtr Parser::ParseReturnStatement()
+    ReturnStatementPtr Parser::ParseReturnStatement()
     {
-        auto statement{ std::make_unique<ast::ReturnStatement>() };
+        auto statement{ mArena->Create<ast::ReturnStatement>() };
         // We only land here after checking the CurrentToken in ParseStatement so it is safe to dereference without checking here 
-        statement->mToken = *GetCurrentToken(); // "return" token
+        statement->mToken = GetCurrentArenaToken(); // "return" token
 
         // TODO: implement logic here to handle expressions
         AdvanceToken(); // advance to the first token of the Expression
@@ -188,12 +412,12 @@ namespace interpreter
         return statement;
     }
 
-    ExpressionStatementUniquePtr Parser::ParseExpressionStatement()
+    ExpressionStatementPtr Parser::ParseExpressionStatement()
     {
-        auto statement{ std::make_unique<ast::ExpressionStatement>() };
-        statement->mToken = *GetCurrentToken();
-        // TODO: Figure out a way so we don't store the same data twice... Essentially mToken is useless here.
-        statement->mValue = std::move(ParseExpression(ast::LOWEST));
+        auto statement{ mArena->Create<ast::ExpressionStatement>() };
+        statement->mToken = GetCurrentArenaToken();
+        // The node that starts the expression gets the same arena Token, so nothing is stored twice
+        statement->mValue = ParseExpression(ast::LOWEST);
 
         if (NextTokenIs(TokenType::SEMICOLON))
         {
@@ -203,19 +427,19 @@ namespace interpreter
         return statement;
     }
 
-    BlockStatementUniquePtr Parser::ParseBlockStatement()
+    BlockStatementPtr Parser::ParseBlockStatement()
     {
-        auto blockStatement{ std::make_unique<ast::BlockStatement>() };
-        blockStatement->mToken = *GetCurrentToken(); // Should be "{"
+        auto blockStatement{ mArena->Create<ast::BlockStatement>(*mArena) };
+        blockStatement->mToken = GetCurrentArenaToken(); // Should be "{"
 
         AdvanceToken();
 
         while (GetCurrentToken() && !CurrentTokenIs(TokenType::RBRACE) && !CurrentTokenIs(TokenType::ENDF))
         {
-            auto statement{ ParseStatement() };
+            auto statement{ ParseStatementAndRecover() };
             if (statement)
             {
-                blockStatement->mStatements.push_back(std::move(statement));
+                blockStatement->mStatements.push_back(statement);
             }
 
             AdvanceToken();
@@ -224,14 +448,28 @@ namespace interpreter
         return blockStatement;
     }
 
-    ConditionBlockStatementUniquePtr Parser::ParseConditionBlockStatement()
+    void Parser::MergeElseIfToken(const Token& elseToken)
+    {
+        // Turn the current "if" token into a single "else if" token spanning both keywords, the span is only kept for locations
+        Token& ifToken{ mLookahead[mCurrent] };
+        assert(ifToken.mType == TokenType::IF && elseToken.mType == TokenType::ELSE);
+
+        const uint32_t length{ ifToken.mOffset + ifToken.mLength - elseToken.mOffset };
+        ifToken.mType = TokenType::ELSE_IF;
+        ifToken.mLiteral = sElseIfLiteral;
+        ifToken.mOffset = elseToken.mOffset;
+        ifToken.mLength = length;
+        mArenaTokens[mCurrent] = nullptr;
+    }
+
+    ConditionBlockStatementPtr Parser::ParseConditionBlockStatement()
     {
-        auto conditionBlockStatement{ std::make_unique<ast::ConditionBlockStatement>() };
+        auto conditionBlockStatement{ mArena->Create<ast::ConditionBlockStatement>() };
         if (!ExpectNextTokenIs(TokenType::LPAREN))
         {
             return nullptr;
         }
-        conditionBlockStatement->mToken = *GetCurrentToken();   // "if" || "else if" token
+        conditionBlockStatement->mToken = GetCurrentArenaToken();   // "if" || "else if" token
         AdvanceToken(); // Advance from "if" || "else if" token -> "(" 
         AdvanceToken(); // Advance from "{" token -> ? we expect an expression to be here as the condition
         conditionBlockStatement->mCondition = ParseExpression(ast::Precedence::LOWEST);
@@ -252,57 +490,146 @@ namespace interpreter
         return conditionBlockStatement;
     }
 
-    ExpressionUniquePtr Parser::ParseExpression(ast::Precedence precedence)
+    ExpressionPtr Parser::ParseExpression(ast::Precedence precedence)
     {
-        if (const Token * token{ GetCurrentToken() })
+        // Operators and "(" that wait for an operand are kept on mPendingExpressions instead of the call stack, so generated input
+        // nests as deep as memory allows. if and fn bodies come back in here through the statement parser, every call only
+        // touches the entries it pushed itself.
+        const size_t base{ mPendingExpressions.size() };
+        ExpressionPtr expression{ nullptr };
+        bool startsOperand{ true };
+        while (true)
         {
-            ExpressionUniquePtr expression;
-
-            if (mPrefixFunctionPtrMap.contains(token->mType))
+            if (startsOperand)
             {
-                PrefixParseFunctionPtr prefixFunctionPtr{ mPrefixFunctionPtrMap.at(token->mType) };
-                expression = prefixFunctionPtr();
-            }
-            else
-            {
-                LOG_MESSAGE(MessageType::ERRORS, std::format("type: {} doesn't have a function associtated with it.", utility::ConvertTokenTypeToString(token->mType)));
+                const Token* token{ GetCurrentToken() };
+                const PrefixParseFunctionPtr prefixFunctionPtr{ token ? sPrefixParseFunctions[static_cast<size_t>(token->mType)] : nullptr };
+                if (prefixFunctionPtr)
+                {
+                    const size_t pending{ mPendingExpressions.size() };
+                    expression = (this->*prefixFunctionPtr)();
+                    if (mPendingExpressions.size() != pending)
+                    {
+                        mPendingExpressions.back().mPrecedence = precedence;
+                        precedence = mPendingExpressions.back().mOperandPrecedence;
+                        continue;
+                    }
+                }
+                else
+                {
+                    if (token)
+                    {
+                        ReportError(DiagnosticCode::NO_PREFIX_PARSE_FUNCTION, 0);
+                    }
+                    expression = nullptr;
+                }
+                startsOperand = false;
             }
 
-            // Added the safe check of GetNextToken() to safeguard the NextTokenIs(), technically speaking we wouldn't need either but it's more readable this way.
-            while (GetNextToken() && !NextTokenIs(TokenType::SEMICOLON) && precedence < GetNextPrecedence())
+            // A failed prefix parse already reported why, there's nothing for an operator to hang on to
+            if (expression)
             {
-                const auto nextToken{ GetNextToken() };
-                if (!nextToken)
+                while (GetNextToken() && !NextTokenIs(TokenType::SEMICOLON) && precedence < GetNextPrecedence())
                 {
-                    return expression;
+                    const InfixParseFunctionPtr infixFunctionPtr{ sInfixParseFunctions[static_cast<size_t>(GetNextToken()->mType)] };
+                    if (!infixFunctionPtr)
+                    {
+                        break;
+                    }
+
+                    AdvanceToken();
+
+                    const size_t pending{ mPendingExpressions.size() };
+                    expression = (this->*infixFunctionPtr)(expression);
+                    if (mPendingExpressions.size() != pending)
+                    {
+                        mPendingExpressions.back().mPrecedence = precedence;
+                        precedence = mPendingExpressions.back().mOperandPrecedence;
+                        startsOperand = true;
+                        break;
+                    }
                 }
 
-                const auto infixExpressionFunctionIterator{ mInfixFunctionPtrMap.find(nextToken->mType) };
-                if (infixExpressionFunctionIterator == mInfixFunctionPtrMap.end())
+                if (startsOperand)
                 {
-                    return expression;
+                    continue;
                 }
+            }
 
-                AdvanceToken();
-
-                expression = infixExpressionFunctionIterator->second(std::move(expression));
+            // The expression at precedence is complete, hand it to whatever waits for it
+            if (mPendingExpressions.size() == base)
+            {
+                return expression;
             }
 
-            return expression;
+            PendingExpression& pending{ mPendingExpressions.back() };
+            if (CompletePendingExpression(pending, expression))
+            {
+                precedence = pending.mOperandPrecedence;
+                startsOperand = true;
+                continue;
+            }
+            precedence = pending.mPrecedence;
+            mPendingExpressions.pop_back();
         }
+    }
 
-        return nullptr;
+    bool Parser::CompletePendingExpression(PendingExpression& pending, ExpressionPtr& expression)
+    {
+        switch (pending.mKind)
+        {
+        case PendingExpressionKind::PrefixOperand:
+            static_cast<ast::PrefixExpression*>(pending.mNode)->mRightSideValue = expression;
+            expression = pending.mNode;
+            return false;
+        case PendingExpressionKind::InfixOperand:
+            static_cast<ast::InfixExpression*>(pending.mNode)->mRightExpression = expression;
+            expression = pending.mNode;
+            return false;
+        case PendingExpressionKind::GroupedExpression:
+            if (!ExpectNextTokenIs(TokenType::RPAREN))
+            {
+                expression = nullptr;
+                return false;
+            }
+            AdvanceToken(); // Advance Past )
+            return false;
+        case PendingExpressionKind::CallArgument:
+        {
+            const auto callExpression{ static_cast<ast::CallExpression*>(pending.mNode) };
+            callExpression->mArguments.push_back(expression);
+            expression = callExpression;
+            if (NextTokenIs(TokenType::COMMA))
+            {
+                AdvanceToken(); // -> ','
+                AdvanceToken(); // -> first part of next argument
+                return true;
+            }
+
+            if (!ExpectNextTokenIs(TokenType::RPAREN))
+            {
+                callExpression->mArguments.clear();
+                return false;
+            }
+            AdvanceToken(); // -> ')'
+            return false;
+        }
+        default:
+            assert(false);
+            return false;
+        }
     }
 
-    ExpressionUniquePtr Parser::ParsePrimitiveExpression()
+    ExpressionPtr Parser::ParsePrimitiveExpression()
     {
-        auto expression{ std::make_unique<ast::PrimitiveExpression>() };
+        auto expression{ mArena->Create<ast::PrimitiveExpression>() };
         // Pointer check done in ParseExpression
-        expression->mToken = *GetCurrentToken();
-        switch (expression->mToken.mType)
+        expression->mToken = GetCurrentArenaToken();
+        switch (expression->mToken->mType)
         {
         case TokenType::IDENT:
             expression->mExpressionType = ast::ExpressionType::IdentifierExpression;
+            expression->mSymbol = expression->mToken->mSymbol;
             break;
         case TokenType::INT:
             expression->mExpressionType = ast::ExpressionType::IntegerExpression;
@@ -315,61 +642,54 @@ namespace interpreter
         return expression;
     }
 
-    ExpressionUniquePtr Parser::ParsePrefixExpression()
+    ExpressionPtr Parser::ParsePrefixExpression()
     {
-        auto expression{ std::make_unique<ast::PrefixExpression>() };
+        auto expression{ mArena->Create<ast::PrefixExpression>() };
         expression->mExpressionType = ast::ExpressionType::PrefixExpression;
         // Pointer check done in ParseExpression
-        expression->mToken = *GetCurrentToken();
-        expression->mOperator = *GetCurrentToken();
+        expression->mToken = GetCurrentArenaToken();
 
         AdvanceToken();
-        expression->mRightSideValue = ParseExpression(ast::PREFIX);
+        mPendingExpressions.push_back({ PendingExpressionKind::PrefixOperand, ast::PREFIX, ast::LOWEST, expression });
 
         return expression;
     }
 
-    ExpressionUniquePtr Parser::ParseInfixExpression(ExpressionUniquePtr leftExpression)
+    ExpressionPtr Parser::ParseInfixExpression(ExpressionPtr leftExpression)
     {
-        auto expression{ std::make_unique<ast::InfixExpression>() };
+        auto expression{ mArena->Create<ast::InfixExpression>() };
         expression->mExpressionType = ast::ExpressionType::InfixExpression;
 
         VERIFY(leftExpression)
         {
-            expression->mLeftExpression = std::move(leftExpression);
+            expression->mLeftExpression = leftExpression;
         }
 
         // TODO: Once the parser is done confirm that this function only get's called from ParseExpression which means we can forego the check
         VERIFY(GetCurrentToken())
         {
-            expression->mToken = *GetCurrentToken();
+            expression->mToken = GetCurrentArenaToken();
         }
 
-        auto precedence{ GetCurrentPrecedence() };
+        const auto precedence{ GetCurrentPrecedence() };
         AdvanceToken();
-        expression->mRightExpression = ParseExpression(precedence);
+        mPendingExpressions.push_back({ PendingExpressionKind::InfixOperand, precedence, ast::LOWEST, expression });
 
         return expression;
     }
 
-    ExpressionUniquePtr Parser::ParseGroupedExpression()
+    ExpressionPtr Parser::ParseGroupedExpression()
     {
         AdvanceToken(); // Advance past (
+        mPendingExpressions.push_back({ PendingExpressionKind::GroupedExpression, ast::LOWEST, ast::LOWEST, nullptr });
 
-        ExpressionUniquePtr expression{ ParseExpression(ast::Precedence::LOWEST) };
-
-        if (!NextTokenIs(TokenType::RPAREN))
-        {
-            return nullptr;
-        }
-        AdvanceToken(); // Advance Past )
-
-        return expression;
+        return nullptr;
     }
 
-    ExpressionUniquePtr Parser::ParseIfExpression()
+    ExpressionPtr Parser::ParseIfExpression()
     {
-        auto expression{ std::make_unique<ast::IfExpression>() };
+        auto expression{ mArena->Create<ast::IfExpression>(*mArena) };
+        expression->mToken = GetCurrentArenaToken();  // "if", shared with the first condition block
         if (!ExpectNextTokenIs(TokenType::LPAREN))
         {
             return nullptr;
@@ -377,13 +697,17 @@ namespace interpreter
         // Parse If condition block
         expression->mIfConditionBlock = ParseConditionBlockStatement();
 
-        while (GetNextToken() && NextTokenIs(TokenType::ELSE_IF))
+        // The Lexer only knows "else" and "if", "else if" is recognized here by looking two tokens ahead
+        while (GetNextToken() && NextTokenIs(TokenType::ELSE) && PeekToken(2) && TokenIs(*PeekToken(2), TokenType::IF))
         {
-            AdvanceToken(); // Advance from "}" -> "else if"
-            ConditionBlockStatementUniquePtr elseIfStatementBlock{ ParseConditionBlockStatement() };
+            AdvanceToken(); // Advance from "}" -> "else"
+            const Token elseToken{ *GetCurrentToken() };
+            AdvanceToken(); // Advance from "else" -> "if"
+            MergeElseIfToken(elseToken);
+            ConditionBlockStatementPtr elseIfStatementBlock{ ParseConditionBlockStatement() };
             if (elseIfStatementBlock)
             {
-                expression->mElseIfBlocks.push_back(std::move(elseIfStatementBlock));
+                expression->mElseIfBlocks.push_back(elseIfStatementBlock);
             }
         }
 
@@ -402,18 +726,18 @@ namespace interpreter
         return expression;
     }
 
-    ExpressionUniquePtr Parser::ParseFunctionExpression()
+    ExpressionPtr Parser::ParseFunctionExpression()
     {
-        auto functionExpression{ std::make_unique<ast::FunctionExpression>() };
+        auto functionExpression{ mArena->Create<ast::FunctionExpression>(*mArena) };
         // The token has been checked in ParseExpression(); no need to check before dereferencing
-        functionExpression->mToken = *GetCurrentToken();    // should be "fn"
+        functionExpression->mToken = GetCurrentArenaToken();    // should be "fn"
 
         if (!ExpectNextTokenIs(TokenType::LPAREN))
         {
             return nullptr;
         }
         AdvanceToken(); // "fn" -> "("
-        functionExpression->mParameters = std::move(ParseFunctionParameters()); // Should leave with CurrentToken == ")"
+        functionExpression->mParameters = ParseFunctionParameters(); // Should leave with CurrentToken == ")"
 
         if (!ExpectNextTokenIs(TokenType::LBRACE))
         {
@@ -425,260 +749,52 @@ namespace interpreter
         return functionExpression;
     }
 
-    std::vector<ExpressionUniquePtr> Parser::ParseFunctionParameters()
+    ArenaVector<ExpressionPtr> Parser::ParseFunctionParameters()
     {
+        ArenaVector<ExpressionPtr> parameters{ *mArena };
         if (NextTokenIs(TokenType::RPAREN))
         {
             AdvanceToken();
-            return {};
+            return parameters;
         }
 
-        std::vector<ExpressionUniquePtr> parameters;
         AdvanceToken(); // "(" -> start of parameter
 
-        parameters.push_back(std::move(ParsePrimitiveExpression()));
+        parameters.push_back(ParsePrimitiveExpression());
 
         while (GetNextToken() && NextTokenIs(TokenType::COMMA))
         {
             AdvanceToken(); // last character of previous identifier -> ","
             AdvanceToken(); // "," -> first character of next parameter
-            parameters.push_back(std::move(ParsePrimitiveExpression()));
+            parameters.push_back(ParsePrimitiveExpression());
         }
 
         if (!ExpectNextTokenIs(TokenType::RPAREN))
         {
-            return {};
+            parameters.clear();
+            return parameters;
         }
         AdvanceToken(); // Advance to ")"
 
         return parameters;
     }
 
-    ExpressionUniquePtr Parser::ParseCallExpression(ExpressionUniquePtr leftExpression)
-    {
-        auto callExpression{ std::make_unique<ast::CallExpression>() };
-        callExpression->mToken = *GetCurrentToken();
-        callExpression->mFunction = std::move(leftExpression);
-        callExpression->mArguments = ParseCallArguments();
-
-        return callExpression;
-    }
-
-    std::vector<ExpressionUniquePtr> Parser::ParseCallArguments()
+    ExpressionPtr Parser::ParseCallExpression(ExpressionPtr leftExpression)
     {
+        auto callExpression{ mArena->Create<ast::CallExpression>(*mArena) };
+        callExpression->mToken = GetCurrentArenaToken();
+        callExpression->mFunction = leftExpression;
         if (NextTokenIs(TokenType::RPAREN))
         {
             AdvanceToken(); // -> ')'
-            return {};
+            return callExpression;
         }
 
-        std::vector<ExpressionUniquePtr> arguments;
         AdvanceToken(); // -> first argument
+        // Arguments are parsed by ParseExpression, see CompletePendingExpression
+        mPendingExpressions.push_back({ PendingExpressionKind::CallArgument, ast::LOWEST, ast::LOWEST, callExpression });
 
-        arguments.push_back(std::move(ParseExpression(ast::Precedence::LOWEST)));
-
-        while (NextTokenIs(TokenType::COMMA))
-        {
-            AdvanceToken(); // -> ','
-            AdvanceToken(); // -> first part of next argument
-            arguments.push_back(std::move(ParseExpression(ast::Precedence::LOWEST)));
-        }
-
-        if (!ExpectNextTokenIs(TokenType::RPAREN))
-        {
-            return {};
-        }
-        AdvanceToken(); // -> ')'
-
-        return arguments;
-    }
-
-    ObjectSharedPtr Parser::Evaluate(ast::Node* node)
-    {
-        VERIFY(node);   // To catch issues.
-
-        // Helper for PrimitiveExpressions
-        const auto GetAndValidateTokenPrimtive = [](ast::Expression* node) -> TokenPrimitive {
-            const auto optionalToken{ node->TokenNode() };
-            assert(optionalToken);
-            return optionalToken->mLiteral;
-        };
-
-        switch (node->mNodeType)
-        {
-        case ast::NodeType::ExpressionStatement:
-            // TODOBB: these could be changed to static casts as we hold metadata, but keeping them dynamic for a bit to make sure everything works
-            if (const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(node) })
-            {
-                return Evaluate(expressionStatement->mValue.get());
-            }
-            else
-            {
-                assert(false);
-            }
-            break;
-        case ast::NodeType::Expression:
-            if (const auto expression{ dynamic_cast<ast::Expression*>(node) })
-            {
-                if (expression->mExpressionType == ast::ExpressionType::IntegerExpression)
-                {
-                    const auto primitive{ GetAndValidateTokenPrimtive(expression) };
-                    return std::make_shared<IntegerType>(std::get<Number>(primitive));
-                }
-                else if (expression->mExpressionType == ast::ExpressionType::BooleanExpression)
-                {
-                    const auto primitive{ GetAndValidateTokenPrimtive(expression) };
-                    return GetNativeBoolObject(std::get<bool>(primitive));
-                }
-                else if (expression->mExpressionType == ast::ExpressionType::PrefixExpression)
-                {
-                    const auto prefixExpression{ dynamic_cast<ast::PrefixExpression*>(expression) };
-                    const auto right{ Evaluate(prefixExpression->mRightSideValue.get()) };
-                    return EvaluatePrefixExpression(prefixExpression->mOperator.mType, right);
-                }
-                else if (expression->mExpressionType == ast::ExpressionType::InfixExpression)
-                {
-                    const auto infixExpression{ dynamic_cast<ast::InfixExpression*>(expression) };
-                    VERIFY(infixExpression)
-                    {
-                        const auto left{ Evaluate(infixExpression->mLeftExpression.get()) };
-                        const auto right{ Evaluate(infixExpression->mRightExpression.get()) };
-                        return EvaluateInfixExpression(infixExpression->mToken.mType, left, right);
-                    }
-                }
-            }
-            break;
-        default:
-            break;
-        }
-
-        return nullptr;
-    }
-
-    ObjectSharedPtr Parser::EvaluatePrefixExpression(TokenType operatorToken, const ObjectSharedPtr& right)
-    {
-        switch (operatorToken)
-        {
-        case TokenType::BANG:   // "!"
-            return EvaluatePrefixBangOperatorExpression(right);
-            break;
-        case TokenType::MINUS:  // "-"
-            return EvaluatePrefixMinusOperatorExpression(right);
-            break;
-        default:
-            LOG_MESSAGE(MessageType::ERRORS, std::format("No Prefix Evaluator for : {}", utility::ConvertTokenTypeToString(operatorToken)));
-            return GetNativeNullObject();
-        }
-        return GetNativeNullObject();
-    }
-
-    ObjectSharedPtr Parser::EvaluatePrefixBangOperatorExpression(const ObjectSharedPtr& right)
-    {
-        // TODOBB: swap dynamic_cast to static_cast once it's confirmed to work.
-        if (right->Type() == "bool")
-        {
-            const auto boolObject{ dynamic_cast<BoolType*>(right.get()) };
-            if (boolObject->mValue)
-            {
-                return GetNativeBoolObject(false);
-            }
-
-            return GetNativeBoolObject(true);
-        }
-        else if (right->Type() == "int")
-        {
-            const auto intObject{ dynamic_cast<IntegerType*>(right.get()) };
-            if (intObject->mValue == 0)
-            {
-                return GetNativeBoolObject(true);
-            }
-
-            return GetNativeBoolObject(false);
-        }
-        else if (right->Type() == "NULL")
-        {
-            return GetNativeBoolObject(true);
-        }
-
-        return GetNativeBoolObject(false);
-    }
-
-    ObjectSharedPtr Parser::EvaluatePrefixMinusOperatorExpression(const ObjectSharedPtr& right)
-    {
-        const auto intObject{ dynamic_cast<IntegerType*>(right.get()) };
-        VERIFY(intObject)
-        {
-            intObject->mValue = ~intObject->mValue;
-            intObject->mValue += 1;
-            return right;
-        }
-
-        return GetNativeNullObject();
-    }
-
-    ObjectSharedPtr Parser::EvaluateInfixExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right)
-    {
-        VERIFY(left && right)
-        {
-            if (left->Type() == right->Type())
-            {
-                if (left->Type() == ObjectTypes::INTEGER_OBJECT)
-                {
-                    return EvaluateInfixIntegerExpression(operatorToken, left, right);
-                }
-            }
-        }
-
-        return GetNativeNullObject();
-    }
-
-    ObjectSharedPtr Parser::EvaluateInfixIntegerExpression(TokenType operatorToken, const ObjectSharedPtr& left, const ObjectSharedPtr& right)
-    {
-        const auto leftInt{ dynamic_cast<IntegerType*>(left.get()) };
-        const auto rightInt{ dynamic_cast<IntegerType*>(right.get()) };
-        VERIFY(leftInt && rightInt)
-        {
-            LOG(MessageType::ERRORS, "Operator : ", operatorToken ," not supported by Number types.");
-            switch (operatorToken)
-            {
-            case TokenType::PLUS:   // '+'
-                return std::make_shared<IntegerType>(leftInt->mValue + rightInt->mValue);
-                break;
-            case TokenType::MINUS:  // '-'
-                return std::make_shared<IntegerType>(leftInt->mValue - rightInt->mValue);
-                break;
-            case TokenType::ASTERISK:  // '*'
-                return std::make_shared<IntegerType>(leftInt->mValue * rightInt->mValue);
-                break;
-            case TokenType::SLASH:  // '/'
-                return std::make_shared<IntegerType>(leftInt->mValue / rightInt->mValue);
-                break;
-            default:
-                LOG(MessageType::ERRORS, "Operator : ", operatorToken ," not supported by Number types.");
-            }
-        }
-
-        return GetNativeNullObject();
-    }
-
-    ObjectSharedPtr Parser::GetNativeBoolObject(bool value)
-    {
-        static std::shared_ptr<BoolType> nativeTrue{ std::make_shared<BoolType>(true) };
-        static std::shared_ptr<BoolType> nativeFalse{ std::make_shared<BoolType>(false) };
-
-        if (value)
-        {
-            return nativeTrue;
-        }
-
-        return nativeFalse;
-    }
-
-    ObjectSharedPtr Parser::GetNativeNullObject()
-    {
-        static std::shared_ptr<NullType> nativeNull{ std::make_shared<NullType>() };
-
-        return nativeNull;
+        return callExpression;
     }
 
     ast::Precedence Parser::GetNextPrecedence()
@@ -705,12 +821,7 @@ namespace interpreter
 
     ast::Precedence Parser::GetPrecedence(const Token& token)
     {
-        if (const auto precedenceIterator{ ast::sOperatorPrecedenceMap.find(token.mType) }; precedenceIterator != ast::sOperatorPrecedenceMap.end())
-        {
-            return precedenceIterator->second;
-        }
-
-        return ast::Precedence::LOWEST;
+        return ast::sOperatorPrecedences[static_cast<size_t>(token.mType)];
     }
 
     bool Parser::NextTokenIs(TokenType tokenType)
@@ -747,10 +858,23 @@ namespace interpreter
                 return true;
             }
 
-            Logger::Log(MessageType::ERRORS, std::format("ERROR: line -> {} character range -> ({},{}) expected next token to be -> {} , actual type -> {}",
-                peekToken->mLineNumber, peekToken->mCharacterRange[0], peekToken->mCharacterRange[1], utility::ConvertTokenTypeToString(expectedType), utility::ConvertTokenTypeToString(peekToken->mType)));
+            ReportError(DiagnosticCode::UNEXPECTED_TOKEN, 1, expectedType);
+        }
+        else
+        {
+            // Already on ENDF, nothing left to peek at
+            ReportError(DiagnosticCode::UNEXPECTED_TOKEN, 0, expectedType);
         }
 
         return false;
     }
+
+    void Parser::ReportError(DiagnosticCode code, size_t distance, TokenType expectedType /*= TokenType::ILLEGAL*/)
+    {
+        const Token* token{ PeekToken(distance) };
+        VERIFY(token)
+        {
+            mDiagnostics.Report(code, *token, mTokenIndices[(mCurrent + distance) & (sLookaheadCapacity - 1)], expectedType);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "ProgramArena.h"
+#include "Utility.h"
+#include <algorithm>
+
+namespace interpreter
+{
+    ProgramArena::ProgramArena(size_t blockSize /* = sDefaultBlockSize*/) :
+        mBlockSize(blockSize),
+        mCurrentBlock(0),
+        mPosition(nullptr),
+        mEnd(nullptr),
+        mBytesAllocated(0)
+    {
+        assert(blockSize > 0);
+    }
+
+    void* ProgramArena::Allocate(size_t size, size_t alignment)
+    {
+        assert(alignment && (alignment & (alignment - 1)) == 0);
+
+        size_t padding{ (alignment - reinterpret_cast<uintptr_t>(mPosition) % alignment) % alignment };
+        if (!mPosition || static_cast<size_t>(mEnd - mPosition) < padding + size)
+        {
+            NextBlock(size + alignment);
+            padding = (alignment - reinterpret_cast<uintptr_t>(mPosition) % alignment) % alignment;
+        }
+
+        std::byte* result{ mPosition + padding };
+        mPosition = result + size;
+        mBytesAllocated += size;
+        return result;
+    }
+
+    void ProgramArena::NextBlock(size_t minimumSize)
+    {
+        // Blocks kept around by Reset are used up first
+        size_t next{ mPosition ? mCurrentBlock + 1 : 0 };
+        while (next < mBlocks.size() && mBlocks[next].mSize < minimumSize)
+        {
+            next++;
+        }
+
+        if (next == mBlocks.size())
+        {
+            // Not value initialized, every byte gets written by whatever is constructed in it
+            const size_t blockSize{ std::max(mBlockSize, minimumSize) };
+            mBlocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[blockSize]), blockSize });
+        }
+
+        mCurrentBlock = next;
+        mPosition = mBlocks[next].mData.get();
+        mEnd = mPosition + mBlocks[next].mSize;
+    }
+
+    void ProgramArena::Reset()
+    {
+        mBytesAllocated = 0;
+        mCurrentBlock = 0;
+        mPosition = mBlocks.empty() ? nullptr : mBlocks.front().mData.get();
+        mEnd = mBlocks.empty() ? nullptr : mPosition + mBlocks.front().mSize;
+    }
+
+    size_t ProgramArena::BytesReserved() const
+    {
+        size_t bytes{};
+        for (const Block& block : mBlocks)
+        {
+            bytes += block.mSize;
+        }
+
+        return bytes;
+    }
+}
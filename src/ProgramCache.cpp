@@ -0,0 +1,81 @@
+#include "ProgramCache.h"
+#include "SourceBuffer.h"
+#include "ConstantFolder.h"
+#include "Utility.h"
+#include <fstream>
+#include <random>
+#include <format>
+
+namespace interpreter
+{
+    ProgramCache::ProgramCache(std::filesystem::path directory) :
+        mDirectory(std::move(directory))
+    {
+    }
+
+    std::optional<ast::FlatProgram> ProgramCache::Find(const SourceBufferSharedPtr& source) const
+    {
+        VERIFY(source)
+        {
+            std::error_code error;
+            const std::filesystem::path path{ GetPath(*source) };
+            if (!std::filesystem::exists(path, error))
+            {
+                return std::nullopt;
+            }
+
+            // Only lives for the decode, the FlatProgram keeps pointing into source and not into the file
+            const SourceBufferSharedPtr file{ SourceBuffer::FromFile(path.string()) };
+            if (!file)
+            {
+                return std::nullopt;
+            }
+            return ast::FlatProgram::Deserialize(file->View(), source, ast::ConstantFolder::sVersion);
+        }
+        return std::nullopt;
+    }
+
+    bool ProgramCache::Store(const ast::FlatProgram& program) const
+    {
+        VERIFY(program.GetSource())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(mDirectory, error);
+            if (error)
+            {
+                return false;
+            }
+
+            // Written next to the final name and renamed into place, so a concurrent run never maps a half written file
+            const std::filesystem::path path{ GetPath(*program.GetSource()) };
+            std::filesystem::path temporaryPath{ path };
+            temporaryPath += "." + std::to_string(std::random_device{}()) + ".tmp";
+
+            const std::string bytes{ program.Serialize(ast::ConstantFolder::sVersion) };
+            {
+                std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+                file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                if (!file)
+                {
+                    file.close();
+                    std::filesystem::remove(temporaryPath, error);
+                    return false;
+                }
+            }
+
+            std::filesystem::rename(temporaryPath, path, error);
+            if (error)
+            {
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    std::filesystem::path ProgramCache::GetPath(const SourceBuffer& source) const
+    {
+        return mDirectory / std::format("{:016x}.ast", source.ContentHash());
+    }
+}
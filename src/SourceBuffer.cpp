@@ -0,0 +1,179 @@
+#include "SourceBuffer.h"
+#include "LineTable.h"
+#include "Utility.h"
+#include "Logger.h"
+#include <format>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace interpreter
+{
+    namespace
+    {
+        bool FitsSourceBuffer(uint64_t size)
+        {
+            if (size > SourceBuffer::sMaxSize)
+            {
+                LOG_MESSAGE(MessageType::ERRORS, std::format("Source of {} bytes is too large, at most {} bytes are supported", size, SourceBuffer::sMaxSize));
+                return false;
+            }
+            return true;
+        }
+    }
+
+    SourceBuffer::~SourceBuffer()
+    {
+        if (!mMapping)
+        {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(mMapping);
+        CloseHandle(mMappingHandle);
+        CloseHandle(mFileHandle);
+#else
+        munmap(mMapping, mSize);
+#endif
+    }
+
+    SourceBufferSharedPtr SourceBuffer::FromFile(std::string_view fileName)
+    {
+        assert(!fileName.empty());
+
+        const std::string path{ fileName };   // The OS wants a null terminated path
+        std::shared_ptr<SourceBuffer> buffer{ new SourceBuffer() };
+
+#ifdef _WIN32
+        HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        if (!FitsSourceBuffer(static_cast<uint64_t>(fileSize.QuadPart)))
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        if (fileSize.QuadPart == 0)
+        {
+            // Empty files can't be mapped
+            CloseHandle(file);
+            return FromString({});
+        }
+
+        HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        void* view{ mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr };
+        if (!view)
+        {
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        buffer->mFileHandle = file;
+        buffer->mMappingHandle = mapping;
+        buffer->mMapping = view;
+        buffer->mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        const int file{ open(path.c_str(), O_RDONLY) };
+        if (file == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat fileStatus {};
+        if (fstat(file, &fileStatus) == -1)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        if (!FitsSourceBuffer(static_cast<uint64_t>(fileStatus.st_size)))
+        {
+            close(file);
+            return nullptr;
+        }
+
+        if (fileStatus.st_size == 0)
+        {
+            // Empty files can't be mapped
+            close(file);
+            return FromString({});
+        }
+
+        void* view{ mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0) };
+        close(file);    // The mapping keeps the file alive
+        if (view == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        madvise(view, static_cast<size_t>(fileStatus.st_size), MADV_SEQUENTIAL);
+
+        buffer->mMapping = view;
+        buffer->mSize = static_cast<size_t>(fileStatus.st_size);
+#endif
+
+        buffer->mData = static_cast<const char*>(buffer->mMapping);
+        return buffer;
+    }
+
+    SourceBufferSharedPtr SourceBuffer::FromString(std::string text)
+    {
+        assert(text.size() <= sMaxSize);
+        std::shared_ptr<SourceBuffer> buffer{ new SourceBuffer() };
+        buffer->mStorage = std::move(text);
+        buffer->mData = buffer->mStorage.data();
+        buffer->mSize = buffer->mStorage.size();
+        return buffer;
+    }
+
+    const LineTable& SourceBuffer::GetLineTable() const
+    {
+        std::call_once(mLineTableOnce, [this]() { mLineTable = std::make_unique<const LineTable>(View()); });
+        return *mLineTable;
+    }
+
+    uint64_t SourceBuffer::ContentHash() const
+    {
+        std::call_once(mContentHashOnce, [this]()
+        {
+            uint64_t hash{ 14695981039346656037ull };
+            for (const char character : View())
+            {
+                hash ^= static_cast<unsigned char>(character);
+                hash *= 1099511628211ull;
+            }
+            mContentHash = hash;
+        });
+        return mContentHash;
+    }
+
+    SourceBufferSharedPtr SourceBuffer::FromStream(std::istream& input)
+    {
+        // Pipes and terminals can't be mapped so they are read into the heap
+        std::string text{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+        return FitsSourceBuffer(text.size()) ? FromString(std::move(text)) : nullptr;
+    }
+}
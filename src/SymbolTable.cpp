@@ -0,0 +1,36 @@
+#include "SymbolTable.h"
+#include "Utility.h"
+
+namespace interpreter
+{
+    SymbolId SymbolTable::Intern(std::string_view spelling)
+    {
+        const auto [symbolIter, inserted] { mSymbols.try_emplace(spelling, utility::narrow_cast<SymbolId>(mSpellings.size())) };
+        if (inserted)
+        {
+            mSpellings.push_back(spelling);
+        }
+
+        return symbolIter->second;
+    }
+
+    std::optional<SymbolId> SymbolTable::Find(std::string_view spelling) const
+    {
+        if (const auto symbolIter{ mSymbols.find(spelling) }; symbolIter != mSymbols.end())
+        {
+            return symbolIter->second;
+        }
+
+        return {};
+    }
+
+    std::string_view SymbolTable::Spelling(SymbolId symbol) const
+    {
+        VERIFY(symbol < mSpellings.size())
+        {
+            return mSpellings[symbol];
+        }
+
+        return {};
+    }
+}
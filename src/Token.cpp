@@ -9,7 +9,7 @@ namespace interpreter
     {
         [[likely]] if (sStringTokens.contains(token.mType))
         {
-            out << std::get<std::string>(token.mLiteral);
+            out << std::get<std::string_view>(token.mLiteral);
         }
         else if (sNumberTokens.contains(token.mType))
         {
@@ -47,7 +47,7 @@ namespace interpreter
                 {
                     out << "NULL";
                 }
-                else if constexpr (std::is_same_v<std::string, Type>)
+                else if constexpr (std::is_same_v<std::string_view, Type>)
                 {
                     out << arg;
                 }
@@ -0,0 +1,103 @@
+#include "TokenStream.h"
+#include "SourceBuffer.h"
+#include "Utility.h"
+
+namespace interpreter
+{
+    TokenStream::TokenStream(SourceBufferSharedPtr source) : mSource(std::move(source))
+    {
+    }
+
+    void TokenStream::Reserve(size_t count)
+    {
+        mTypes.reserve(count);
+        mOffsets.reserve(count);
+        mLengths.reserve(count);
+        mPayloads.reserve(count);
+    }
+
+    void TokenStream::Push(const Token& token)
+    {
+        uint32_t payload{};
+        if (token.mType == TokenType::IDENT)
+        {
+            payload = token.mSymbol;
+        }
+        else if (token.mType == TokenType::INT)
+        {
+            payload = utility::narrow_cast<uint32_t>(mNumbers.size());
+            mNumbers.push_back(std::get<Number>(token.mLiteral));
+        }
+
+        mTypes.push_back(token.mType);
+        mOffsets.push_back(token.mOffset);
+        mLengths.push_back(token.mLength);
+        mPayloads.push_back(payload);
+    }
+
+    void TokenStream::Append(const TokenStream& other, const std::vector<SymbolId>& symbolRemap)
+    {
+        assert(!other.Empty() && other.mTypes.back() == TokenType::ENDF);
+        const size_t count{ other.Size() - 1 };
+        const uint32_t numberBase{ utility::narrow_cast<uint32_t>(mNumbers.size()) };
+
+        mTypes.insert(mTypes.end(), other.mTypes.begin(), other.mTypes.begin() + count);
+        mOffsets.insert(mOffsets.end(), other.mOffsets.begin(), other.mOffsets.begin() + count);
+        mLengths.insert(mLengths.end(), other.mLengths.begin(), other.mLengths.begin() + count);
+        mNumbers.insert(mNumbers.end(), other.mNumbers.begin(), other.mNumbers.end());
+
+        for (size_t i = 0; i != count; i++)
+        {
+            uint32_t payload{ other.mPayloads[i] };
+            if (other.mTypes[i] == TokenType::IDENT)
+            {
+                payload = symbolRemap[payload];
+            }
+            else if (other.mTypes[i] == TokenType::INT)
+            {
+                payload += numberBase;
+            }
+            mPayloads.push_back(payload);
+        }
+    }
+
+    std::string_view TokenStream::Text(size_t index) const
+    {
+        return mSource->View().substr(mOffsets[index], mLengths[index]);
+    }
+
+    Token TokenStream::Get(size_t index) const
+    {
+        Token token;
+        token.mType = mTypes[index];
+        token.mOffset = mOffsets[index];
+        token.mLength = mLengths[index];
+
+        switch (token.mType)
+        {
+        case TokenType::INT:
+            token.mLiteral = mNumbers[mPayloads[index]];
+            break;
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            token.mLiteral = token.mType == TokenType::TRUE;
+            break;
+        case TokenType::IDENT:
+            token.mSymbol = mPayloads[index];
+            token.mLiteral = Text(index);
+            break;
+        default:
+            token.mLiteral = Text(index);
+            break;
+        }
+
+        return token;
+    }
+
+    size_t TokenStream::MemoryUsage() const
+    {
+        return mTypes.capacity() * sizeof(TokenType) +
+            (mOffsets.capacity() + mLengths.capacity() + mPayloads.capacity()) * sizeof(uint32_t) +
+            mNumbers.capacity() * sizeof(Number);
+    }
+}
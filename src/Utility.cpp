@@ -1,11 +1,76 @@
 #include "Utility.h"
 #include <iostream>
 #include <sstream>
+#include <bit>
+#include <cstring>
+#include <limits>
 
 namespace interpreter
 {
     namespace utility
     {
+        namespace
+        {
+            // Perfect hash over sKeywords: every keyword lands in its own slot so a lookup is one hash and one short compare.
+            constexpr size_t sKeywordTableSize{ 16 };
+            static_assert((sKeywordTableSize & (sKeywordTableSize - 1)) == 0 && sKeywordTableSize >= sKeywords.size());
+
+            constexpr size_t KeywordHash(std::string_view literal, uint32_t seed)
+            {
+                return (static_cast<uint8_t>(literal.front()) * seed + static_cast<uint8_t>(literal.back()) + literal.size()) & (sKeywordTableSize - 1);
+            }
+
+            constexpr bool IsPerfectKeywordSeed(uint32_t seed)
+            {
+                std::array<bool, sKeywordTableSize> used{};
+                for (const Keyword& keyword : sKeywords)
+                {
+                    const size_t slot{ KeywordHash(keyword.mLiteral, seed) };
+                    if (used[slot])
+                    {
+                        return false;
+                    }
+                    used[slot] = true;
+                }
+
+                return true;
+            }
+
+            constexpr uint32_t FindKeywordSeed()
+            {
+                for (uint32_t seed = 1; seed != 1024; seed++)
+                {
+                    if (IsPerfectKeywordSeed(seed))
+                    {
+                        return seed;
+                    }
+                }
+
+                return 0;
+            }
+
+            constexpr uint32_t sKeywordSeed{ FindKeywordSeed() };
+            static_assert(sKeywordSeed != 0, "No perfect hash seed for the keyword set, grow sKeywordTableSize or change KeywordHash");
+
+            constexpr std::array<Keyword, sKeywordTableSize> BuildKeywordTable()
+            {
+                std::array<Keyword, sKeywordTableSize> table{};
+                for (Keyword& slot : table)
+                {
+                    slot.mType = TokenType::IDENT;
+                }
+
+                for (const Keyword& keyword : sKeywords)
+                {
+                    table[KeywordHash(keyword.mLiteral, sKeywordSeed)] = keyword;
+                }
+
+                return table;
+            }
+
+            constexpr std::array<Keyword, sKeywordTableSize> sKeywordTable{ BuildKeywordTable() };
+        }
+
         bool IsLetter(char character)
         {
             return ('a' <= character && character <= 'z') || ('A' <= character && character <= 'Z') || character == '_';
@@ -16,54 +81,109 @@ namespace interpreter
             return ('0' <= character && character <= '9');
         }
 
-        // TODO: This assumes the string isn't holding a number larger than 2^63-1 or smaller than -2^63
-        int64_t ToNumber(std::string_view literal)
+        bool IsWhiteSpace(char character)
         {
-            int64_t number{};
-            for (const char digit : literal)
-            {
-                VERIFY(IsDigit(digit))
-                {
-                    number *= 10;
-                    number += 0x0F & digit;
-                }
-            }
-
-            return number;
+            return character == ' ' || character == '\t' || character == '\r' || character == '\n';
         }
 
-        bool ValidateStringNumber(std::string_view literal)
+        NumberParseResult ParseNumber(std::string_view literal, Number& number)
         {
-            // 9223 3720 3685 4775 807       ----------- 19 digits ------------
-            // -9223 3720 3685 4775 808     
-            // If we really care about that 1 extra for negative numbers we can store numbers as unsigned in the Tokens
-            static constexpr const char* INT64_T_MAX{ "9223372036854775807" };
+            // The literal is walked exactly once. Anything up to 18 digits fits, longer literals check every multiply-add against the limit.
+            constexpr uint64_t sMaxNumber{ static_cast<uint64_t>(std::numeric_limits<Number>::max()) };
+            constexpr uint64_t sEightDigits{ 100'000'000 };
+            constexpr size_t sMaxSafeDigits{ std::numeric_limits<Number>::digits10 };
 
-            // It's most likely that the string is less than 19 digits long. If so there is no need to test further.
-            if (literal.size() < 19)
+            if (literal.empty())
             {
-                return true;
+                return NumberParseResult::INVALID_DIGIT;
             }
 
-            // If it's exactly 19 digits long we have to check.
-            if (literal.size() == 19)
+            const bool mayOverflow{ literal.size() > sMaxSafeDigits };
+            uint64_t value{};
+            const char* read{ literal.data() };
+            const char* end{ read + literal.size() };
+
+            if constexpr (std::endian::native == std::endian::little)
             {
-                for (int i = 0; i != 19; i++)
+                // SWAR: 8 digits per step, the first character ends up in the lowest byte.
+                for (; end - read >= 8; read += 8)
                 {
-                    if (literal[i] < INT64_T_MAX[i])
+                    uint64_t chunk;
+                    memcpy(&chunk, read, sizeof(chunk));
+
+                    // Every byte has to be in ['0', '9']: high nibble 3 and adding 6 mustn't carry into it
+                    if (((chunk & 0xF0F0F0F0F0F0F0F0) | ((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4) != 0x3333333333333333)
                     {
-                        return true;
+                        return NumberParseResult::INVALID_DIGIT;
                     }
-                    else if (literal[i] > INT64_T_MAX[i])
+
+                    chunk -= 0x3030303030303030;
+                    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FF;          // pairs
+                    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFF;        // quads
+                    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFF;      // all 8
+
+                    if (mayOverflow && value > (sMaxNumber - chunk) / sEightDigits)
                     {
-                        return false;
+                        return NumberParseResult::OVERFLOWED;
                     }
+                    value = value * sEightDigits + chunk;
+                }
+            }
+
+            for (; read != end; ++read)
+            {
+                const uint64_t digit{ static_cast<uint64_t>(static_cast<uint8_t>(*read - '0')) };
+                if (digit > 9)
+                {
+                    return NumberParseResult::INVALID_DIGIT;
                 }
 
-                return true;    // Means it's equal.
+                if (mayOverflow && value > (sMaxNumber - digit) / 10)
+                {
+                    return NumberParseResult::OVERFLOWED;
+                }
+                value = value * 10 + digit;
             }
 
-            return false;
+            number = static_cast<Number>(value);
+            return NumberParseResult::OK;
+        }
+
+        bool AddNumbers(Number left, Number right, Number& result)
+        {
+            constexpr Number sMaxNumber{ std::numeric_limits<Number>::max() };
+            constexpr Number sMinNumber{ std::numeric_limits<Number>::min() };
+            if ((right > 0 && left > sMaxNumber - right) || (right < 0 && left < sMinNumber - right))
+            {
+                return false;
+            }
+            result = left + right;
+            return true;
+        }
+
+        bool SubtractNumbers(Number left, Number right, Number& result)
+        {
+            constexpr Number sMaxNumber{ std::numeric_limits<Number>::max() };
+            constexpr Number sMinNumber{ std::numeric_limits<Number>::min() };
+            if ((right < 0 && left > sMaxNumber + right) || (right > 0 && left < sMinNumber + right))
+            {
+                return false;
+            }
+            result = left - right;
+            return true;
+        }
+
+        bool MultiplyNumbers(Number left, Number right, Number& result)
+        {
+            constexpr Number sMaxNumber{ std::numeric_limits<Number>::max() };
+            constexpr Number sMinNumber{ std::numeric_limits<Number>::min() };
+            if (left > 0 ? (right > 0 ? left > sMaxNumber / right : right < sMinNumber / left)
+                         : (right > 0 ? left < sMinNumber / right : left != 0 && right < sMaxNumber / left))
+            {
+                return false;
+            }
+            result = left * right;
+            return true;
         }
 
         bool CompareTokens(const Token& left, const Token& right)
@@ -77,8 +197,21 @@ namespace interpreter
                 return false;
             }
 
-            bool leftIsString{ std::holds_alternative<std::string>(left.mLiteral) };
-            bool rightIsString{ std::holds_alternative<std::string>(right.mLiteral) };
+            if (left.mSymbol != sNoSymbol && right.mSymbol != sNoSymbol)
+            {
+                VERIFY(left.mSymbol == right.mSymbol) {}
+                else
+                {
+                    std::cout << "ERROR: Token symbols are not the same: " << left.mSymbol << " : " << right.mSymbol << std::endl;
+
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool leftIsString{ std::holds_alternative<std::string_view>(left.mLiteral) };
+            bool rightIsString{ std::holds_alternative<std::string_view>(right.mLiteral) };
 
             VERIFY(leftIsString == rightIsString) {}
             else
@@ -90,8 +223,8 @@ namespace interpreter
 
             if (leftIsString)
             {
-                const auto leftValue{ std::get<std::string>(left.mLiteral) };
-                const auto rightValue{ std::get<std::string>(right.mLiteral) };
+                const auto leftValue{ std::get<std::string_view>(left.mLiteral) };
+                const auto rightValue{ std::get<std::string_view>(right.mLiteral) };
                 VERIFY(leftValue == rightValue) {}
             else
             {
@@ -129,41 +262,36 @@ namespace interpreter
             return "NO TOKEN TYPE IN MAP";
         }
 
-        void AssignToToken(Token& token, TokenType tokenType, std::string_view literal, CharacterRange* characterRange)
-        {
-            token.mType = tokenType;
-            token.mLiteral.emplace<std::string>(literal);
-            memcpy(token.mCharacterRange, characterRange, 2 * sizeof(CharacterRange));
-        }
-
-        void AssignToToken(Token& token, TokenType tokenType, const char literal, CharacterRange* characterRange)
+        void AssignToToken(Token& token, TokenType tokenType, std::string_view literal)
         {
             token.mType = tokenType;
-            std::string str{ literal };
-            token.mLiteral.emplace<std::string>(str);
-            memcpy(token.mCharacterRange, characterRange, 2 * sizeof(CharacterRange));
+            token.mLiteral.emplace<std::string_view>(literal);
         }
 
-        void AssignToToken(Token& token, TokenType tokenType, Number literal, CharacterRange* characterRange)
+        void AssignToToken(Token& token, TokenType tokenType, Number literal)
         {
             token.mType = tokenType;
             token.mLiteral.emplace<Number>(literal);
-            memcpy(token.mCharacterRange, characterRange, 2 * sizeof(CharacterRange));
         }
 
-        void AssignToToken(Token& token, TokenType tokenType, bool literal, CharacterRange* characterRange)
+        void AssignToToken(Token& token, TokenType tokenType, bool literal)
         {
             token.mType = tokenType;
             token.mLiteral.emplace<bool>(literal);
-            memcpy(token.mCharacterRange, characterRange, 2 * sizeof(CharacterRange));
         }
 
         TokenType DeriveIdentifierToken(std::string_view literal)
         {
-            std::string word{ literal };
-            if (const auto keywordIter{ sKeywordsMap.find(word) }; keywordIter != sKeywordsMap.end())
+            if (literal.empty())
             {
-                return keywordIter->second;
+                return TokenType::IDENT;
+            }
+
+            // Empty slots hold an empty literal so they can never compare equal to an identifier.
+            const Keyword& keyword{ sKeywordTable[KeywordHash(literal, sKeywordSeed)] };
+            if (keyword.mLiteral == literal)
+            {
+                return keyword.mType;
             }
 
             return TokenType::IDENT;
@@ -179,25 +307,5 @@ namespace interpreter
 
             return out.str();
         }
-
-        std::string ReadTextFile(std::string_view fileName)
-        {
-            assert(!fileName.empty());
-
-            // eat the file so we can determine the size
-            std::ifstream input(fileName.data(), std::ios::in | std::ios::binary | std::ios::ate);
-            VERIFY(input.good())
-            {
-                std::ifstream::pos_type fileSize{ input.tellg() };
-                input.seekg(0, std::ios::beg);
-
-                std::string bytes(static_cast<size_t>(fileSize), '\0');  // Need to use Parentheses to legally cast to size_t
-                input.read(&bytes[0], fileSize);    // Note: this limits us to ASCI.
-
-                return bytes;   // NRVO should make this a move operation
-            }
-
-            return {};
-        }
     }
 }
@@ -2,8 +2,25 @@
 #include "Parser.h"
 #include "AbstractSyntaxTree.h"
 #include "Objects.h"
+#include "CharacterScanner.h"
+#include "SourceBuffer.h"
+#include "SymbolTable.h"
+#include "TokenStream.h"
+#include "LineTable.h"
+#include "FlatAst.h"
+#include "Diagnostics.h"
+#include "IncrementalParser.h"
+#include "ProgramCache.h"
+#include "OutputBuffer.h"
+#include "ConstantFolder.h"
+#include "Evaluator.h"
+#include <algorithm>
+#include <thread>
 #include <limits>
+#include <filesystem>
+#include <sstream>
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.hpp"
 
 #undef TRUE
@@ -27,10 +44,9 @@ namespace interpreter
         bool TestIdentifier(ast::Expression* expression, std::string_view expectedValue)
         {
             REQUIRE(expression->mExpressionType == ast::ExpressionType::IdentifierExpression);
-            const auto identifierToken{ expression->TokenNode() };
-            REQUIRE(identifierToken);
-            REQUIRE(std::holds_alternative<std::string>(identifierToken->mLiteral));
-            const auto identifier{ std::get<std::string>(identifierToken->mLiteral) };
+            const Token& identifierToken{ expression->TokenNode() };
+            REQUIRE(std::holds_alternative<std::string_view>(identifierToken.mLiteral));
+            const auto identifier{ std::get<std::string_view>(identifierToken.mLiteral) };
             REQUIRE(identifier == expectedValue);
             return true;
         }
@@ -38,10 +54,9 @@ namespace interpreter
         bool TestInteger(ast::Expression* expression, Number expectedValue)
         {
             REQUIRE(expression->mExpressionType == ast::ExpressionType::IntegerExpression);
-            const auto integerToken{ expression->TokenNode() };
-            REQUIRE(integerToken);
-            REQUIRE(std::holds_alternative<Number>(integerToken->mLiteral));
-            const auto number{ std::get<Number>(integerToken->mLiteral) };
+            const Token& integerToken{ expression->TokenNode() };
+            REQUIRE(std::holds_alternative<Number>(integerToken.mLiteral));
+            const auto number{ std::get<Number>(integerToken.mLiteral) };
             REQUIRE(number == expectedValue);
             return true;
         }
@@ -49,9 +64,8 @@ namespace interpreter
         bool TestBoolean(ast::Expression* expression, bool expectedValue)
         {
             REQUIRE(expression->mExpressionType == ast::ExpressionType::BooleanExpression);
-            const auto boolToken{ expression->TokenNode() };
-            REQUIRE(boolToken);
-            const auto booleanValue{ std::get<bool>(boolToken->mLiteral) };
+            const Token& boolToken{ expression->TokenNode() };
+            const auto booleanValue{ std::get<bool>(boolToken.mLiteral) };
             REQUIRE(booleanValue == expectedValue);
             return true;
         }
@@ -61,7 +75,7 @@ namespace interpreter
             std::visit([&expression](const auto& arg) {
                 using ExpectedType = std::decay_t<decltype(arg)>;
 
-                if constexpr (std::is_same_v<std::string, ExpectedType>)
+                if constexpr (std::is_same_v<std::string_view, ExpectedType>)
                 {
                     return TestIdentifier(expression, arg);
                 }
@@ -96,12 +110,35 @@ namespace interpreter
             REQUIRE(expression->mExpressionType == ast::ExpressionType::InfixExpression);
             const auto infixExpression{ dynamic_cast<ast::InfixExpression*>(expression) };
             REQUIRE(infixExpression);
-            TestPrimitiveExpression(infixExpression->mLeftExpression.get(), left);
-            REQUIRE(infixExpression->TokenNode()->mType == opType);
-            REQUIRE(infixExpression->mRightExpression.get());
-            TestPrimitiveExpression(infixExpression->mRightExpression.get(), right);
+            TestPrimitiveExpression(infixExpression->mLeftExpression, left);
+            REQUIRE(infixExpression->TokenNode().mType == opType);
+            REQUIRE(infixExpression->mRightExpression);
+            TestPrimitiveExpression(infixExpression->mRightExpression, right);
             return true;
         }
+
+        void RequireSameTokens(const Lexer& expected, const Lexer& actual)
+        {
+            const TokenStream& expectedTokens{ expected.GetTokens() };
+            const TokenStream& actualTokens{ actual.GetTokens() };
+            REQUIRE(expectedTokens.Size() == actualTokens.Size());
+            for (size_t i = 0; i != expectedTokens.Size(); i++)
+            {
+                const Token expectedToken{ expectedTokens.Get(i) };
+                const Token actualToken{ actualTokens.Get(i) };
+                REQUIRE(expectedToken.mType == actualToken.mType);
+                REQUIRE(expectedToken.mOffset == actualToken.mOffset);
+                REQUIRE(expectedToken.mLength == actualToken.mLength);
+                REQUIRE(expectedToken.mSymbol == actualToken.mSymbol);
+                REQUIRE(expectedToken.mLiteral == actualToken.mLiteral);
+            }
+
+            REQUIRE(expected.GetSymbols()->Size() == actual.GetSymbols()->Size());
+            for (SymbolId symbol = 0; symbol != expected.GetSymbols()->Size(); symbol++)
+            {
+                REQUIRE(expected.GetSymbols()->Spelling(symbol) == actual.GetSymbols()->Spelling(symbol));
+            }
+        }
     }
 
     TEST_CASE("LEXER TEST")
@@ -113,7 +150,7 @@ namespace interpreter
         //x + y;
         //};
         //let result = add(five, ten);
-        std::string lexerInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<interpreter::Lexer>(lexerInput) };
         std::vector<interpreter::Token> expected
         {
@@ -204,9 +241,9 @@ namespace interpreter
                 continue;
             }
 
-            if (std::holds_alternative<std::string>(results[i].mLiteral))
+            if (std::holds_alternative<std::string_view>(results[i].mLiteral))
             {
-                REQUIRE(std::get<std::string>(expected[i].mLiteral) == std::get<std::string>(results[i].mLiteral));
+                REQUIRE(std::get<std::string_view>(expected[i].mLiteral) == std::get<std::string_view>(results[i].mLiteral));
             }
             else if (std::holds_alternative<Number>(results[i].mLiteral))
             {
@@ -219,9 +256,378 @@ namespace interpreter
         }
     }
 
+    TEST_CASE("LexerSourceViewTest")
+    {
+        SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        interpreter::LexerUniquePtr lexer{ std::make_unique<interpreter::Lexer>(lexerInput) };
+        const SourceBufferSharedPtr& source{ lexer->GetSource() };
+        REQUIRE(source);
+        REQUIRE(source == lexerInput);     // Borrowed, not copied
+        REQUIRE(source->IsMapped());
+
+        // Every textual literal has to be a view into the lexer's source instead of a copy.
+        const char* sourceBegin{ source->Data() };
+        const char* sourceEnd{ source->Data() + source->Size() };
+        for (const Token& token : lexer->GetTokens())
+        {
+            if (std::holds_alternative<std::string_view>(token.mLiteral) && token.mType != TokenType::ENDF)
+            {
+                const auto literal{ std::get<std::string_view>(token.mLiteral) };
+                REQUIRE(!literal.empty());
+                REQUIRE(sourceBegin <= literal.data());
+                REQUIRE(literal.data() + literal.size() <= sourceEnd);
+            }
+        }
+
+        // Streams can't be mapped, their text is read into the heap
+        std::istringstream stream{ std::string{ lexerInput->View() } };
+        const SourceBufferSharedPtr streamed{ SourceBuffer::FromStream(stream) };
+        REQUIRE(!streamed->IsMapped());
+        REQUIRE(streamed->View() == lexerInput->View());
+    }
+
+    TEST_CASE("TokenStreamTest")
+    {
+        SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        const Lexer tokenizingLexer{ lexerInput };
+        const TokenStream& tokens{ tokenizingLexer.GetTokens() };
+
+        REQUIRE(!tokens.Empty());
+        REQUIRE(tokens.Type(tokens.Size() - 1) == TokenType::ENDF);
+        REQUIRE(tokens.Offset(tokens.Size() - 1) == lexerInput->Size());
+
+        // Literals are rebuilt from the source, integers from the side table
+        uint32_t previousOffset{ 0 };
+        for (size_t i = 0; i != tokens.Size(); i++)
+        {
+            const Token token{ tokens.Get(i) };
+            REQUIRE(token.mType == tokens.Type(i));
+            REQUIRE(token.mOffset == tokens.Offset(i));
+            REQUIRE(token.mLength == tokens.Length(i));
+            REQUIRE(token.mOffset >= previousOffset);
+            previousOffset = token.mOffset + token.mLength;
+
+            const std::string_view text{ tokens.Text(i) };
+            REQUIRE(lexerInput->View().substr(token.mOffset, token.mLength) == text);
+            if (token.mType == TokenType::INT)
+            {
+                Number value{};
+                REQUIRE(utility::ParseNumber(text, value) == utility::NumberParseResult::OK);
+                REQUIRE(std::get<Number>(token.mLiteral) == value);
+            }
+            else if (token.mType == TokenType::TRUE || token.mType == TokenType::FALSE)
+            {
+                REQUIRE(std::get<bool>(token.mLiteral) == (token.mType == TokenType::TRUE));
+            }
+            else
+            {
+                REQUIRE(std::get<std::string_view>(token.mLiteral) == text);
+            }
+        }
+
+        REQUIRE(tokens.MemoryUsage() < tokens.Size() * sizeof(Token));
+    }
+
+    TEST_CASE("LineTableTest")
+    {
+        SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        const Lexer lexer{ lexerInput };
+        const TokenStream& tokens{ lexer.GetTokens() };
+        const LineTable& lines{ lexerInput->GetLineTable() };
+        REQUIRE(&lines == &lexerInput->GetLineTable());     // Built once
+
+        // let five = 5;
+        // let ten = 10;
+        REQUIRE(tokens.Text(1) == "five");
+        const SourceLocation five{ lines.Locate(tokens.Offset(1)) };
+        REQUIRE(five.mLine == 0);
+        REQUIRE(five.mColumn == 4);
+        REQUIRE(tokens.Text(6) == "ten");
+        const SourceLocation ten{ lines.Locate(tokens.Offset(6)) };
+        REQUIRE(ten.mLine == 1);
+        REQUIRE(ten.mColumn == 4);
+
+        // Every token has to sit on the line its offset falls into
+        const std::string_view source{ lexerInput->View() };
+        for (size_t i = 0; i + 1 != tokens.Size(); i++)
+        {
+            const SourceLocation location{ lines.Locate(tokens.Offset(i)) };
+            const size_t lineStart{ tokens.Offset(i) - location.mColumn };
+            REQUIRE((lineStart == 0 || source[lineStart - 1] == '\n'));
+            REQUIRE(source.substr(lineStart, location.mColumn).find('\n') == std::string_view::npos);
+            REQUIRE(static_cast<size_t>(std::count(source.begin(), source.begin() + lineStart, '\n')) == location.mLine);
+        }
+
+        // Columns used to be 16 bit, long generated lines have to locate correctly
+        std::string longLine{ "let a = 1;" };
+        longLine.append(70000, ' ');
+        longLine += "let b = 2;\nb";
+        const Lexer longLineLexer{ longLine };
+        const TokenStream& longLineTokens{ longLineLexer.GetTokens() };
+        REQUIRE(longLineTokens.Text(6) == "b");
+        const SourceLocation b{ longLineLexer.GetSource()->GetLineTable().Locate(longLineTokens.Offset(6)) };
+        REQUIRE(b.mLine == 0);
+        REQUIRE(b.mColumn == 70014);
+        const SourceLocation lastB{ longLineLexer.GetSource()->GetLineTable().Locate(longLineTokens.Offset(10)) };
+        REQUIRE(lastB.mLine == 1);
+        REQUIRE(lastB.mColumn == 0);
+    }
+
+    TEST_CASE("CharacterScannerTest")
+    {
+        // Runs of every class with lengths around the 16 and 32 byte block sizes, separated by characters that end the run.
+        std::string input;
+        const std::string_view fillers[]{ " \t\r\n", "aZ_9", "0123456789" };
+        const std::string_view breakers{ "+;(\x80{" };
+        for (int length = 0; length != 70; length++)
+        {
+            for (const auto filler : fillers)
+            {
+                for (int i = 0; i != length; i++)
+                {
+                    input += filler[(i * 7 + length) % filler.size()];
+                }
+                input += breakers[length % breakers.size()];
+            }
+        }
+
+        const char* begin{ input.data() };
+        const char* end{ input.data() + input.size() };
+        const auto& supportedKernels{ scanner::GetSupportedKernels() };
+        REQUIRE(!supportedKernels.empty());
+        const scanner::ScannerKernels& scalar{ supportedKernels.front() };
+
+        for (const auto& kernels : supportedKernels)
+        {
+            INFO(kernels.mName);
+            for (const char* position = begin; position != end; position++)
+            {
+                REQUIRE(kernels.mFindWhiteSpaceEnd(position, end) == scalar.mFindWhiteSpaceEnd(position, end));
+                REQUIRE(kernels.mFindNewLine(position, end) == scalar.mFindNewLine(position, end));
+                REQUIRE(kernels.mFindIdentifierEnd(position, end) == scalar.mFindIdentifierEnd(position, end));
+                REQUIRE(kernels.mFindDigitEnd(position, end) == scalar.mFindDigitEnd(position, end));
+            }
+        }
+    }
+
+    TEST_CASE("NumberParseTest")
+    {
+        using utility::NumberParseResult;
+        const auto Parse = [](std::string_view literal, Number& number) { return utility::ParseNumber(literal, number); };
+
+        // Every length from 1 to 19 digits so both the 8 digit blocks and the scalar tail get covered
+        Number expectedNumber{ 0 };
+        for (int digits = 1; digits != 20; digits++)
+        {
+            expectedNumber = expectedNumber * 10 + (digits % 10);
+            const std::string literal{ std::to_string(expectedNumber) };
+            Number number{ -1 };
+            REQUIRE(Parse(literal, number) == NumberParseResult::OK);
+            REQUIRE(number == expectedNumber);
+        }
+
+        Number number{ -1 };
+        REQUIRE(Parse("0", number) == NumberParseResult::OK);
+        REQUIRE(number == 0);
+        REQUIRE(Parse("0000000000000000000000042", number) == NumberParseResult::OK);
+        REQUIRE(number == 42);
+        REQUIRE(Parse("9223372036854775807", number) == NumberParseResult::OK);
+        REQUIRE(number == std::numeric_limits<Number>::max());
+
+        number = -1;
+        REQUIRE(Parse("9223372036854775808", number) == NumberParseResult::OVERFLOWED);
+        REQUIRE(Parse("10000000000000000000", number) == NumberParseResult::OVERFLOWED);
+        REQUIRE(Parse("99999999999999999999999999", number) == NumberParseResult::OVERFLOWED);
+        REQUIRE(Parse("", number) == NumberParseResult::INVALID_DIGIT);
+        REQUIRE(Parse("1234a678", number) == NumberParseResult::INVALID_DIGIT);
+        REQUIRE(Parse("12345678:", number) == NumberParseResult::INVALID_DIGIT);
+        REQUIRE(Parse("/2345678", number) == NumberParseResult::INVALID_DIGIT);
+        REQUIRE(number == -1);
+
+        // Literals that don't fit are reported and lexed as 0
+        const Lexer lexer{ "9223372036854775807 9223372036854775808;" };
+        const TokenStream& tokens{ lexer.GetTokens() };
+        REQUIRE(tokens.Size() == 4);
+        REQUIRE(std::get<Number>(tokens.Get(0).mLiteral) == std::numeric_limits<Number>::max());
+        REQUIRE(tokens.Type(1) == TokenType::INT);
+        REQUIRE(std::get<Number>(tokens.Get(1).mLiteral) == 0);
+    }
+
+    TEST_CASE("KeywordLookupTest")
+    {
+        for (const Keyword& keyword : sKeywords)
+        {
+            REQUIRE(utility::DeriveIdentifierToken(keyword.mLiteral) == keyword.mType);
+        }
+
+        const std::string_view identifiers[]{ "f", "fnn", "lets", "True", "fals", "iff", "els", "elseif", "returns", "x", "_", "foobar" };
+        for (const auto identifier : identifiers)
+        {
+            REQUIRE(utility::DeriveIdentifierToken(identifier) == TokenType::IDENT);
+        }
+    }
+
+    TEST_CASE("KeywordLookupBenchmark", "[.][benchmark]")
+    {
+        // The keyword map DeriveIdentifierToken used to hash into
+        const std::unordered_map<std::string, TokenType> keywordsMap
+        {
+            {"fn",TokenType::FUNCTION},
+            {"let", TokenType::LET},
+            {"true", TokenType::TRUE},
+            {"false", TokenType::FALSE},
+            {"if", TokenType::IF},
+            {"else",TokenType::ELSE},
+            {"else if", TokenType::ELSE_IF},
+            {"return", TokenType::RETURN}
+        };
+
+        const std::string_view words[]{ "let", "counter", "fn", "x", "y", "return", "if", "result", "else", "true", "add", "false", "foobar", "value" };
+        std::vector<std::string_view> identifiers;
+        for (int i = 0; i != 100000; i++)
+        {
+            identifiers.push_back(words[(i * 31) % std::size(words)]);
+        }
+
+        BENCHMARK("unordered_map")
+        {
+            size_t keywords{};
+            for (const auto identifier : identifiers)
+            {
+                if (const auto keywordIter{ keywordsMap.find(std::string{ identifier }) }; keywordIter != keywordsMap.end())
+                {
+                    keywords++;
+                }
+            }
+            return keywords;
+        };
+
+        BENCHMARK("perfect hash")
+        {
+            size_t keywords{};
+            for (const auto identifier : identifiers)
+            {
+                if (utility::DeriveIdentifierToken(identifier) != TokenType::IDENT)
+                {
+                    keywords++;
+                }
+            }
+            return keywords;
+        };
+    }
+
+    TEST_CASE("LexerThroughputBenchmark", "[.][benchmark]")
+    {
+        // Mixed corpus: keywords, identifiers, numbers, single and double character operators
+        const SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        std::string corpus;
+        for (int i = 0; i != 4000; i++)
+        {
+            corpus += lexerInput->View();
+        }
+
+        const size_t tokenCount{ Lexer(corpus).GetTokens().Size() };
+        WARN("tokens per pass: " << tokenCount << ", bytes per pass: " << corpus.size());
+
+        BENCHMARK("Tokenize mixed corpus")
+        {
+            return Lexer(corpus).GetTokens().Size();
+        };
+    }
+
+    TEST_CASE("ParallelLexerTest")
+    {
+        // A few test inputs glued together a hundred times, lexed in chunks of a few KB
+        std::string corpus;
+        for (const char* fileName : { "lexerTestData.txt", "elseIfTest.txt", "operatorPrecedenceTest.txt", "functionParameterTest.txt" })
+        {
+            corpus += SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName)->View();
+            corpus += '\n';
+        }
+        std::string input;
+        for (int i = 0; i != 100; i++)
+        {
+            input += corpus;
+            input += "let x" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+        }
+        input += "let big = 99999999999999999999;\n";
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString(std::move(input)) };
+
+        const Lexer sequential{ source };
+        for (const size_t chunkSize : { size_t{ 1 }, size_t{ 4096 }, size_t{ 100000 }, Lexer::sDefaultChunkSize })
+        {
+            INFO("chunk size: " << chunkSize);
+            const Lexer parallel{ source, LexerMode::PARALLEL, chunkSize };
+            test::RequireSameTokens(sequential, parallel);
+        }
+
+        // Sources without a single newline can't be split
+        const SourceBufferSharedPtr singleLine{ SourceBuffer::FromString("let a = 1; let b = a + 2;") };
+        test::RequireSameTokens(Lexer{ singleLine }, Lexer{ singleLine, LexerMode::PARALLEL, 1 });
+    }
+
+    TEST_CASE("ParallelLexerBenchmark", "[.][benchmark]")
+    {
+        const SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        std::string corpus;
+        while (corpus.size() < 128 * 1024 * 1024)
+        {
+            corpus += lexerInput->View();
+        }
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString(std::move(corpus)) };
+
+        test::RequireSameTokens(Lexer{ source }, Lexer{ source, LexerMode::PARALLEL });
+        WARN("bytes: " << source->Size() << ", hardware threads: " << std::thread::hardware_concurrency());
+
+        BENCHMARK("Sequential")
+        {
+            return Lexer(source).GetTokens().Size();
+        };
+
+        BENCHMARK("Parallel")
+        {
+            return Lexer(source, LexerMode::PARALLEL).GetTokens().Size();
+        };
+    }
+
+    TEST_CASE("SymbolInterningTest")
+    {
+        SourceBufferSharedPtr lexerInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/lexerTestData.txt") };
+        interpreter::LexerUniquePtr lexer{ std::make_unique<interpreter::Lexer>(lexerInput) };
+        const SymbolTableSharedPtr symbols{ lexer->GetSymbols() };
+        REQUIRE(symbols);
+
+        // five, ten, add, x, y, result
+        REQUIRE(symbols->Size() == 6);
+        for (const Token& token : lexer->GetTokens())
+        {
+            if (token.mType != TokenType::IDENT)
+            {
+                REQUIRE(token.mSymbol == sNoSymbol);
+                continue;
+            }
+
+            REQUIRE(token.mSymbol != sNoSymbol);
+            REQUIRE(symbols->Spelling(token.mSymbol) == std::get<std::string_view>(token.mLiteral));
+            REQUIRE(symbols->Find(std::get<std::string_view>(token.mLiteral)) == token.mSymbol);
+        }
+        REQUIRE(!symbols->Find("let"));
+
+        interpreter::Parser parser{ std::move(lexer) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        REQUIRE(program->mSymbols == symbols);
+
+        // let five = 5;
+        const auto letStatement{ dynamic_cast<ast::LetStatement*>(program->mStatements[0]) };
+        REQUIRE(letStatement);
+        const auto identifier{ dynamic_cast<ast::PrimitiveExpression*>(letStatement->mIdentifier) };
+        REQUIRE(identifier);
+        REQUIRE(identifier->mSymbol == symbols->Find("five"));
+    }
+
     TEST_CASE("PARSER Statement tests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/parserTestData.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/parserTestData.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -233,19 +639,17 @@ namespace interpreter
 
         for (int i = 0; i != 3; i++)
         {
-            ast::LetStatement* letStatement{ dynamic_cast<ast::LetStatement*>(program->mStatements[i].get()) };
+            ast::LetStatement* letStatement{ dynamic_cast<ast::LetStatement*>(program->mStatements[i]) };
             REQUIRE(letStatement != nullptr);
 
-            REQUIRE(letStatement->mToken.mType == TokenType::LET);
+            REQUIRE(letStatement->TokenNode().mType == TokenType::LET);
             if (letStatement->mIdentifier)
             {
-                if (const auto token{ letStatement->mIdentifier->TokenNode() })
+                const Token& token{ letStatement->mIdentifier->TokenNode() };
+                REQUIRE(std::holds_alternative<std::string_view>(token.mLiteral));
+                if (std::holds_alternative<std::string_view>(token.mLiteral))
                 {
-                    REQUIRE(std::holds_alternative<std::string>(token->mLiteral));
-                    if (std::holds_alternative<std::string>(token->mLiteral))
-                    {
-                        REQUIRE(std::get<std::string>(token->mLiteral) == expectedIdentifiers[i]);
-                    }
+                    REQUIRE(std::get<std::string_view>(token.mLiteral) == expectedIdentifiers[i]);
                 }
             }
         }
@@ -253,7 +657,7 @@ namespace interpreter
 
     TEST_CASE("IdentExpressionTests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/identifierExpressionStatementsTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/identifierExpressionStatementsTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -262,26 +666,26 @@ namespace interpreter
         REQUIRE(program->mStatements.size() == 1);
         REQUIRE(program->mStatements[0]->mNodeType == ast::NodeType::ExpressionStatement);
 
-        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0].get()) };
+        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0]) };
         REQUIRE(expressionStatement);
         REQUIRE(expressionStatement->mValue);
 
-        auto token{ program->mStatements[0]->TokenNode() };
-        REQUIRE(token);
-        REQUIRE(token->mType == TokenType::IDENT);
-        REQUIRE(std::holds_alternative<std::string>(token->mLiteral) == true);
-        REQUIRE(std::get<std::string>(token->mLiteral) == "foobar");
-
-        auto expressionToken{ expressionStatement->mValue->TokenNode() };
-        REQUIRE(expressionToken);
-        REQUIRE(expressionToken->mType == TokenType::IDENT);
-        REQUIRE(std::holds_alternative<std::string>(expressionToken->mLiteral) == true);
-        REQUIRE(std::get<std::string>(expressionToken->mLiteral) == "foobar");
+        const Token& token{ program->mStatements[0]->TokenNode() };
+        REQUIRE(token.mType == TokenType::IDENT);
+        REQUIRE(std::holds_alternative<std::string_view>(token.mLiteral) == true);
+        REQUIRE(std::get<std::string_view>(token.mLiteral) == "foobar");
+
+        const Token& expressionToken{ expressionStatement->mValue->TokenNode() };
+        REQUIRE(expressionToken.mType == TokenType::IDENT);
+        REQUIRE(std::holds_alternative<std::string_view>(expressionToken.mLiteral) == true);
+        REQUIRE(std::get<std::string_view>(expressionToken.mLiteral) == "foobar");
+        // The statement and the expression it starts with share one Token
+        REQUIRE(&token == &expressionToken);
     }
 
     TEST_CASE("IntegerExpressionTests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/integerExpressionStatementsTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/integerExpressionStatementsTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -290,26 +694,24 @@ namespace interpreter
         REQUIRE(program->mStatements.size() == 1);
         REQUIRE(program->mStatements[0]->mNodeType == ast::NodeType::ExpressionStatement);
 
-        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0].get()) };
+        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0]) };
         REQUIRE(expressionStatement);
         REQUIRE(expressionStatement->mValue);
 
-        auto token{ program->mStatements[0]->TokenNode() };
-        REQUIRE(token);
-        REQUIRE(token->mType == TokenType::INT);
-        REQUIRE(std::holds_alternative<Number>(token->mLiteral) == true);
-        REQUIRE(std::get<Number>(token->mLiteral) == 5);
+        const Token& token{ program->mStatements[0]->TokenNode() };
+        REQUIRE(token.mType == TokenType::INT);
+        REQUIRE(std::holds_alternative<Number>(token.mLiteral) == true);
+        REQUIRE(std::get<Number>(token.mLiteral) == 5);
 
-        auto expressionToken{ expressionStatement->mValue->TokenNode() };
-        REQUIRE(expressionToken);
-        REQUIRE(expressionToken->mType == TokenType::INT);
-        REQUIRE(std::holds_alternative<Number>(expressionToken->mLiteral) == true);
-        REQUIRE(std::get<Number>(expressionToken->mLiteral) == 5);
+        const Token& expressionToken{ expressionStatement->mValue->TokenNode() };
+        REQUIRE(expressionToken.mType == TokenType::INT);
+        REQUIRE(std::holds_alternative<Number>(expressionToken.mLiteral) == true);
+        REQUIRE(std::get<Number>(expressionToken.mLiteral) == 5);
     }
 
     TEST_CASE("PrefixOperatorExpressionTests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/prefixOperatorExpressionStatementsTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/prefixOperatorExpressionStatementsTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -326,23 +728,23 @@ namespace interpreter
         {
             REQUIRE(program->mStatements[i]->mNodeType == ast::NodeType::ExpressionStatement);
 
-            ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[i].get()) };
+            ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[i]) };
             REQUIRE(expressionStatement);
             REQUIRE(expressionStatement->mValue);
 
             REQUIRE(expressionStatement->mValue->mExpressionType == ast::ExpressionType::PrefixExpression);
-            const auto prefixExpression{ dynamic_cast<ast::PrefixExpression*>(expressionStatement->mValue.get()) };
+            const auto prefixExpression{ dynamic_cast<ast::PrefixExpression*>(expressionStatement->mValue) };
             REQUIRE(prefixExpression);
 
-            REQUIRE(prefixExpression->mToken.mType == prefixTests[i][0].mType);
-            REQUIRE(prefixExpression->mRightSideValue->TokenNode()->mType == prefixTests[i][1].mType);
-            REQUIRE(utility::CompareTokens(*prefixExpression->mRightSideValue->TokenNode(), prefixTests[i][1]));
+            REQUIRE(prefixExpression->TokenNode().mType == prefixTests[i][0].mType);
+            REQUIRE(prefixExpression->mRightSideValue->TokenNode().mType == prefixTests[i][1].mType);
+            REQUIRE(utility::CompareTokens(prefixExpression->mRightSideValue->TokenNode(), prefixTests[i][1]));
         }
     }
 
     TEST_CASE("InfixOperatorExpressionTests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/operatorPrecedenceTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/operatorPrecedenceTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -371,9 +773,27 @@ namespace interpreter
         REQUIRE(program->Log() == operatorPrecedenceTests);
     }
 
+    TEST_CASE("StreamingParserTest")
+    {
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/operatorPrecedenceTest.txt") };
+
+        interpreter::Parser tokenizedParser{ std::make_unique<Lexer>(parserInput) };
+        interpreter::ProgramUniquePtr tokenizedProgram{ tokenizedParser.ParseProgram() };
+
+        interpreter::LexerUniquePtr streamingLexer{ std::make_unique<Lexer>(parserInput, LexerMode::STREAM) };
+        REQUIRE(streamingLexer->GetTokens().Empty());
+        interpreter::Parser streamingParser{ std::move(streamingLexer) };
+        interpreter::ProgramUniquePtr streamingProgram{ streamingParser.ParseProgram() };
+
+        REQUIRE(tokenizedProgram);
+        REQUIRE(streamingProgram);
+        REQUIRE(streamingProgram->mStatements.size() == tokenizedProgram->mStatements.size());
+        REQUIRE(streamingProgram->Log() == tokenizedProgram->Log());
+    }
+
     TEST_CASE("BooleanExpressionTests")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/booleanExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/booleanExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -384,28 +804,28 @@ namespace interpreter
 
         for (int i = 0; i != 2; i++)
         {
-            const auto statement{ program->mStatements[i].get() };
+            const auto statement{ program->mStatements[i] };
             REQUIRE(statement->mNodeType == ast::NodeType::ExpressionStatement);
             const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(statement) };
             REQUIRE(expressionStatement->mValue);
             REQUIRE(expressionStatement->mValue->mExpressionType == ast::ExpressionType::BooleanExpression);
-            test::TestPrimitiveExpression(expressionStatement->mValue.get(), booleans[i]);
+            test::TestPrimitiveExpression(expressionStatement->mValue, booleans[i]);
         }
 
         for (int i = 2; i != 4; i++)
         {
-            const auto statement{ program->mStatements[i].get() };
+            const auto statement{ program->mStatements[i] };
             REQUIRE(statement->mNodeType == ast::NodeType::LetStatement);
             const auto letStatement{ dynamic_cast<ast::LetStatement*>(statement) };
-            test::TestPrimitiveExpression(letStatement->mIdentifier.get(), letTest[i - 2].identifier);
-            test::TestPrimitiveExpression(letStatement->mValue.get(), letTest[i - 2].boolean);
+            test::TestPrimitiveExpression(letStatement->mIdentifier, letTest[i - 2].identifier);
+            test::TestPrimitiveExpression(letStatement->mValue, letTest[i - 2].boolean);
         }
         REQUIRE(program != nullptr);
     }
 
     TEST_CASE("InfixExpressionTest2")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/infixExpressionTest2.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/infixExpressionTest2.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -414,11 +834,11 @@ namespace interpreter
 
         for (int i = 0; i != 3; i++)
         {
-            ast::Statement* statement{ program->mStatements[i].get() };
+            ast::Statement* statement{ program->mStatements[i] };
             REQUIRE(statement->mNodeType == ast::NodeType::ExpressionStatement);
             const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(statement) };
 
-            ast::Expression* expression{ expressionStatement->mValue.get() };
+            ast::Expression* expression{ expressionStatement->mValue };
             REQUIRE(expression);
             const auto infixExpression{ dynamic_cast<ast::InfixExpression*>(expression) };
             REQUIRE(infixExpression);
@@ -429,7 +849,7 @@ namespace interpreter
 
     TEST_CASE("GroupedExpressionsTest")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/groupedExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/groupedExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -453,191 +873,219 @@ namespace interpreter
         //      x
         //  }
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/ifExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/ifExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
         REQUIRE(program->mStatements.size() == 1);
-        ast::Statement* statement{ program->mStatements[0].get() };
+        ast::Statement* statement{ program->mStatements[0] };
         REQUIRE(statement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(statement) };
         REQUIRE(expressionStatement);
 
         REQUIRE(expressionStatement->mValue);
-        ast::Expression* expression{ expressionStatement->mValue.get() };
+        ast::Expression* expression{ expressionStatement->mValue };
         REQUIRE(expression->mExpressionType == ast::ExpressionType::IfExpression);
         const auto ifExpression{ dynamic_cast<ast::IfExpression*>(expression) };
         REQUIRE(ifExpression);
 
-        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock.get() };
+        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock };
         REQUIRE(ifStatement);
         REQUIRE(ifStatement->mNodeType == ast::NodeType::ConditionBlockStatement);
         const auto ifConditionBlockStatement{ dynamic_cast<ast::ConditionBlockStatement*>(ifStatement) };
         REQUIRE(ifConditionBlockStatement);
 
-        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition.get() };
+        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition };
         REQUIRE(ifConditionExpression);
         test::TestInfixExpression(ifConditionExpression, "x", TokenType::LT, "y");
 
-        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock.get() };
+        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock };
         REQUIRE(ifBStatement);
         REQUIRE(ifBStatement->mNodeType == ast::NodeType::BlockStatement);
         const auto ifBlockStatement{ dynamic_cast<ast::BlockStatement*>(ifBStatement) };
         REQUIRE(ifBlockStatement);
         REQUIRE(ifBlockStatement->mStatements.size() == 1);
-        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0].get() };
+        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0] };
         REQUIRE(consequenceStatement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto consequenceExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(consequenceStatement) };
         REQUIRE(consequenceExpressionStatement);
         REQUIRE(consequenceExpressionStatement->mValue);
-        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue.get(), "x");
+        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue, "x");
         REQUIRE(!ifExpression->mAlternative);
     }
 
     TEST_CASE("IfElseExpressionTest")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/ifElseExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/ifElseExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
         REQUIRE(program->mStatements.size() == 1);
-        ast::Statement* statement{ program->mStatements[0].get() };
+        ast::Statement* statement{ program->mStatements[0] };
         REQUIRE(statement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(statement) };
         REQUIRE(expressionStatement);
 
         REQUIRE(expressionStatement->mValue);
-        ast::Expression* expression{ expressionStatement->mValue.get() };
+        ast::Expression* expression{ expressionStatement->mValue };
         REQUIRE(expression->mExpressionType == ast::ExpressionType::IfExpression);
         const auto ifExpression{ dynamic_cast<ast::IfExpression*>(expression) };
         REQUIRE(ifExpression);
 
-        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock.get() };
+        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock };
         REQUIRE(ifStatement);
         REQUIRE(ifStatement->mNodeType == ast::NodeType::ConditionBlockStatement);
         const auto ifConditionBlockStatement{ dynamic_cast<ast::ConditionBlockStatement*>(ifStatement) };
         REQUIRE(ifConditionBlockStatement);
 
-        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition.get() };
+        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition };
         REQUIRE(ifConditionExpression);
         test::TestInfixExpression(ifConditionExpression, "x", TokenType::LT, "y");
 
-        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock.get() };
+        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock };
         REQUIRE(ifBStatement);
         REQUIRE(ifBStatement->mNodeType == ast::NodeType::BlockStatement);
         const auto ifBlockStatement{ dynamic_cast<ast::BlockStatement*>(ifBStatement) };
         REQUIRE(ifBlockStatement);
         REQUIRE(ifBlockStatement->mStatements.size() == 1);
-        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0].get() };
+        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0] };
         REQUIRE(consequenceStatement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto consequenceExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(consequenceStatement) };
         REQUIRE(consequenceExpressionStatement);
         REQUIRE(consequenceExpressionStatement->mValue);
-        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue.get(), "x");
+        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue, "x");
 
         REQUIRE(ifExpression->mAlternative);
-        ast::Statement* alternativeStatement{ ifExpression->mAlternative->mStatements[0].get() };
+        ast::Statement* alternativeStatement{ ifExpression->mAlternative->mStatements[0] };
         REQUIRE(alternativeStatement);
         const auto alternativeExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(alternativeStatement) };
         REQUIRE(alternativeExpressionStatement);
         REQUIRE(alternativeExpressionStatement->mValue);
-        test::TestPrimitiveExpression(alternativeExpressionStatement->mValue.get(), "y");
+        test::TestPrimitiveExpression(alternativeExpressionStatement->mValue, "y");
     }
 
     TEST_CASE("ElseIfTest")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/elseIfTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/elseIfTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
+
+        // The lexer never looks past "else", the Parser pairs it up with the following "if"
+        size_t elseCount{};
+        const TokenStream& tokens{ lexer->GetTokens() };
+        for (size_t i = 0; i != tokens.Size(); i++)
+        {
+            REQUIRE(tokens.Type(i) != TokenType::ELSE_IF);
+            elseCount += tokens.Type(i) == TokenType::ELSE;
+        }
+        REQUIRE(elseCount == 3);
+
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
         REQUIRE(program->mStatements.size() == 1);
-        ast::Statement* statement{ program->mStatements[0].get() };
+        ast::Statement* statement{ program->mStatements[0] };
         REQUIRE(statement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(statement) };
         REQUIRE(expressionStatement);
 
         REQUIRE(expressionStatement->mValue);
-        ast::Expression* expression{ expressionStatement->mValue.get() };
+        ast::Expression* expression{ expressionStatement->mValue };
         REQUIRE(expression->mExpressionType == ast::ExpressionType::IfExpression);
         const auto ifExpression{ dynamic_cast<ast::IfExpression*>(expression) };
         REQUIRE(ifExpression);
 
-        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock.get() };
+        ast::Statement* ifStatement{ ifExpression->mIfConditionBlock };
         REQUIRE(ifStatement);
         REQUIRE(ifStatement->mNodeType == ast::NodeType::ConditionBlockStatement);
         const auto ifConditionBlockStatement{ dynamic_cast<ast::ConditionBlockStatement*>(ifStatement) };
         REQUIRE(ifConditionBlockStatement);
 
-        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition.get() };
+        ast::Expression* ifConditionExpression{ ifConditionBlockStatement->mCondition };
         REQUIRE(ifConditionExpression);
         test::TestInfixExpression(ifConditionExpression, "x", TokenType::LT, "y");
 
-        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock.get() };
+        ast::Statement* ifBStatement{ ifConditionBlockStatement->mBlock };
         REQUIRE(ifBStatement);
         REQUIRE(ifBStatement->mNodeType == ast::NodeType::BlockStatement);
         const auto ifBlockStatement{ dynamic_cast<ast::BlockStatement*>(ifBStatement) };
         REQUIRE(ifBlockStatement);
         REQUIRE(ifBlockStatement->mStatements.size() == 1);
-        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0].get() };
+        ast::Statement* consequenceStatement{ ifBlockStatement->mStatements[0] };
         REQUIRE(consequenceStatement->mNodeType == ast::NodeType::ExpressionStatement);
         const auto consequenceExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(consequenceStatement) };
         REQUIRE(consequenceExpressionStatement);
         REQUIRE(consequenceExpressionStatement->mValue);
-        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue.get(), "work");
+        test::TestPrimitiveExpression(consequenceExpressionStatement->mValue, "work");
 
         std::vector<test::InfixExpressionData> testData{ {5, TokenType::LT, 4}, {4, TokenType::NOT_EQ, 5} };
         REQUIRE(!ifExpression->mElseIfBlocks.empty());
         for (int i = 0; i != 2; i++)
         {
-            ast::ConditionBlockStatement* elseConditionBlock{ ifExpression->mElseIfBlocks[i].get() };
+            ast::ConditionBlockStatement* elseConditionBlock{ ifExpression->mElseIfBlocks[i] };
             REQUIRE(elseConditionBlock);
-            ast::Expression* elseCondition{ elseConditionBlock->mCondition.get() };
+            REQUIRE(elseConditionBlock->TokenNode().mType == TokenType::ELSE_IF);
+            REQUIRE(std::get<std::string_view>(elseConditionBlock->TokenNode().mLiteral) == "else if");
+            ast::Expression* elseCondition{ elseConditionBlock->mCondition };
             REQUIRE(elseCondition);
             test::TestInfixExpression(elseCondition, testData[i].left, testData[i].opType, testData[i].right);
             REQUIRE(elseConditionBlock->mBlock);
-            ast::Statement* elseStatement{ elseConditionBlock->mBlock->mStatements[0].get() };
+            ast::Statement* elseStatement{ elseConditionBlock->mBlock->mStatements[0] };
             REQUIRE(elseStatement);
             const auto elseExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(elseStatement) };
             REQUIRE(elseExpressionStatement);
-            test::TestPrimitiveExpression(elseExpressionStatement->mValue.get(), "work");
+            test::TestPrimitiveExpression(elseExpressionStatement->mValue, "work");
         }
 
         REQUIRE(ifExpression->mAlternative);
-        ast::Statement* alternativeStatement{ ifExpression->mAlternative->mStatements[0].get() };
+        ast::Statement* alternativeStatement{ ifExpression->mAlternative->mStatements[0] };
         REQUIRE(alternativeStatement);
         const auto alternativeExpressionStatement{ dynamic_cast<ast::ExpressionStatement*>(alternativeStatement) };
         REQUIRE(alternativeExpressionStatement);
         REQUIRE(alternativeExpressionStatement->mValue);
-        test::TestPrimitiveExpression(alternativeExpressionStatement->mValue.get(), "work");
+        test::TestPrimitiveExpression(alternativeExpressionStatement->mValue, "work");
+
+        // Whatever sits between the two keywords, the merged token reads "else if" and only its span covers the gap
+        const SourceBufferSharedPtr spaced{ SourceBuffer::FromString("if (x) { 1 } else\n\t  if (y) { 2 };") };
+        interpreter::Parser spacedParser{ std::make_unique<Lexer>(spaced) };
+        const interpreter::ProgramUniquePtr spacedProgram{ spacedParser.ParseProgram() };
+        REQUIRE(spacedParser.GetDiagnostics().Count() == 0);
+        REQUIRE(spacedProgram->Log() == "ifx{ 1 }else ify{ 2 } \n");
+        const auto spacedIf{ dynamic_cast<ast::IfExpression*>(dynamic_cast<ast::ExpressionStatement*>(spacedProgram->mStatements[0])->mValue) };
+        REQUIRE(spacedIf);
+        const Token& elseIfToken{ spacedIf->mElseIfBlocks[0]->TokenNode() };
+        REQUIRE(std::get<std::string_view>(elseIfToken.mLiteral) == "else if");
+        REQUIRE(spaced->View().substr(elseIfToken.mOffset, elseIfToken.mLength) == "else\n\t  if");
+        const ast::FlatProgram flatProgram{ ast::FlatProgram::FromProgram(*spacedProgram) };
+        REQUIRE(flatProgram.Log() == spacedProgram->Log());
+        REQUIRE(ast::FlatProgram::Deserialize(flatProgram.Serialize(), spaced)->ToProgram()->Log() == spacedProgram->Log());
     }
 
     TEST_CASE("FunctionExpressionTest")
     {
         // fn(x,y) { x + y; }
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/functionExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/functionExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
         REQUIRE(program);
         REQUIRE(program->mStatements.size() == 1);
-        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0].get()) };
+        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0]) };
         REQUIRE(expressionStatement);
 
-        auto functionExpression{ dynamic_cast<ast::FunctionExpression*>(expressionStatement->mValue.get()) };
+        auto functionExpression{ dynamic_cast<ast::FunctionExpression*>(expressionStatement->mValue) };
         REQUIRE(functionExpression);
         REQUIRE(functionExpression->mParameters.size() == 2);
-        test::TestPrimitiveExpression(functionExpression->mParameters[0].get(), "x");
-        test::TestPrimitiveExpression(functionExpression->mParameters[1].get(), "y");
+        test::TestPrimitiveExpression(functionExpression->mParameters[0], "x");
+        test::TestPrimitiveExpression(functionExpression->mParameters[1], "y");
 
         REQUIRE(functionExpression->mBody);
         REQUIRE(functionExpression->mBody->mStatements.size() == 1);
-        ast::ExpressionStatement* bodyStatement{ dynamic_cast<ast::ExpressionStatement*>(functionExpression->mBody->mStatements[0].get()) };
-        ast::Expression* infixExpression{ bodyStatement->mValue.get() };
+        ast::ExpressionStatement* bodyStatement{ dynamic_cast<ast::ExpressionStatement*>(functionExpression->mBody->mStatements[0]) };
+        ast::Expression* infixExpression{ bodyStatement->mValue };
         test::TestInfixExpression(infixExpression, "x", TokenType::PLUS, "y");
     }
 
@@ -647,7 +1095,7 @@ namespace interpreter
         // fn(x) {};
         // fn(x, y, x) {};
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/functionParameterTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/functionParameterTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -657,15 +1105,15 @@ namespace interpreter
         REQUIRE(program->mStatements.size() == 3);
         for (int i = 0; i != 3; i++)
         {
-            ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[i].get()) };
+            ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[i]) };
             REQUIRE(expressionStatement);
 
-            auto functionExpression{ dynamic_cast<ast::FunctionExpression*>(expressionStatement->mValue.get()) };
+            auto functionExpression{ dynamic_cast<ast::FunctionExpression*>(expressionStatement->mValue) };
             REQUIRE(functionExpression);
             REQUIRE(functionExpression->mParameters.size() == testData[i].size());
             for (int j = 0; j != testData[i].size(); j++)
             {
-                test::TestPrimitiveExpression(functionExpression->mParameters[j].get(), testData[i][j]);
+                test::TestPrimitiveExpression(functionExpression->mParameters[j], testData[i][j]);
             }
         }
 
@@ -675,24 +1123,802 @@ namespace interpreter
     {
         // add(1 , 2 * 3, 4 + 5);
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/callExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/callExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
         REQUIRE(program);
         REQUIRE(program->mStatements.size() == 1);
-        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0].get()) };
+        ast::ExpressionStatement* expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0]) };
         REQUIRE(expressionStatement);
 
-        auto callExpression{ dynamic_cast<ast::CallExpression*>(expressionStatement->mValue.get()) };
+        auto callExpression{ dynamic_cast<ast::CallExpression*>(expressionStatement->mValue) };
         REQUIRE(callExpression);
         REQUIRE(callExpression->mFunction);
-        test::TestPrimitiveExpression(callExpression->mFunction.get(), "add");
+        test::TestPrimitiveExpression(callExpression->mFunction, "add");
         REQUIRE(callExpression->mArguments.size() == 3);
-        test::TestPrimitiveExpression(callExpression->mArguments[0].get(), 1);
-        test::TestInfixExpression(callExpression->mArguments[1].get(), 2, TokenType::ASTERISK, 3);
-        test::TestInfixExpression(callExpression->mArguments[2].get(), 4, TokenType::PLUS, 5);
+        test::TestPrimitiveExpression(callExpression->mArguments[0], 1);
+        test::TestInfixExpression(callExpression->mArguments[1], 2, TokenType::ASTERISK, 3);
+        test::TestInfixExpression(callExpression->mArguments[2], 4, TokenType::PLUS, 5);
+    }
+
+    TEST_CASE("DeeplyNestedExpressionTest")
+    {
+        // Generated input can nest far deeper than the call stack would allow a recursive parser to go
+        constexpr size_t depth{ 100000 };
+        const auto parse = [](std::string text)
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(text))) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            REQUIRE(program);
+            REQUIRE(parser.GetDiagnostics().Count() == 0);
+            REQUIRE(program->mStatements.size() == 1);
+            const auto expressionStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[0]) };
+            REQUIRE(expressionStatement);
+            return std::make_pair(std::move(program), expressionStatement->mValue);
+        };
+
+        SECTION("Grouped")
+        {
+            // ((((1 + 2)))) * 3;
+            const auto [program, expression] { parse(std::string(depth, '(') + "1 + 2" + std::string(depth, ')') + " * 3;") };
+            const auto infixExpression{ dynamic_cast<ast::InfixExpression*>(expression) };
+            REQUIRE(infixExpression);
+            REQUIRE(infixExpression->mToken->mType == TokenType::ASTERISK);
+            test::TestInfixExpression(infixExpression->mLeftExpression, 1, TokenType::PLUS, 2);
+            test::TestPrimitiveExpression(infixExpression->mRightExpression, 3);
+        }
+
+        SECTION("Prefix")
+        {
+            // !!!!true;
+            std::string text;
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                text += "!";
+            }
+            const auto [program, expression] { parse(text + "true;") };
+            ast::Expression* operand{ expression };
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                const auto prefixExpression{ dynamic_cast<ast::PrefixExpression*>(operand) };
+                REQUIRE(prefixExpression);
+                operand = prefixExpression->mRightSideValue;
+            }
+            test::TestPrimitiveExpression(operand, true);
+        }
+
+        SECTION("Calls and operators")
+        {
+            // f(1 + f(1 + f(1 + 2)));
+            std::string text;
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                text += "f(1 + ";
+            }
+            const auto [program, expression] { parse(text + "2" + std::string(depth, ')') + ";") };
+            ast::Expression* argument{ expression };
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                const auto callExpression{ dynamic_cast<ast::CallExpression*>(argument) };
+                REQUIRE(callExpression);
+                test::TestPrimitiveExpression(callExpression->mFunction, "f");
+                REQUIRE(callExpression->mArguments.size() == 1);
+                const auto infixExpression{ dynamic_cast<ast::InfixExpression*>(callExpression->mArguments[0]) };
+                REQUIRE(infixExpression);
+                test::TestPrimitiveExpression(infixExpression->mLeftExpression, 1);
+                argument = infixExpression->mRightExpression;
+            }
+            test::TestPrimitiveExpression(argument, 2);
+        }
+
+        SECTION("Unbalanced")
+        {
+            // Every group is missing its ")", the statement after them still parses
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::string(depth, '(') + "1; 2;")) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            REQUIRE(parser.GetDiagnostics().Count() == depth);
+            REQUIRE(parser.GetDiagnostics().GetDiagnostics()[0].mExpected == TokenType::RPAREN);
+            REQUIRE(program->Log() == "2\n");
+        }
+
+        SECTION("Walks")
+        {
+            // Whatever the parser takes in, logging, flattening, folding and evaluating get through as well
+            const auto walk = [](std::string text, const std::string& value)
+            {
+                interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(text))) };
+                interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+                REQUIRE(parser.GetDiagnostics().Count() == 0);
+                REQUIRE(ast::FlatProgram::FromProgram(*program).Log() == program->Log());
+                REQUIRE(Evaluator{}.Evaluate(*program).back()->Inspect() == value);
+                ast::ConstantFolder{ *program }.Fold();
+                REQUIRE(Evaluator{}.Evaluate(*program).back()->Inspect() == value);
+                return program->Log();
+            };
+
+            // 0 + 1 + 1 + 1;
+            std::string sum{ "0" };
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                sum += " + 1";
+            }
+            REQUIRE(walk(sum + ";", std::to_string(depth)) == std::to_string(depth) + "\n");
+            // - - - -1;
+            REQUIRE(walk(std::string(depth, '-') + "1;", "1") == "1\n");
+            // f(f(f(0)));
+            std::string calls{ "let f = fn(x) { x + 1 }; " };
+            for (size_t i{ 0 }; i < depth; i++)
+            {
+                calls += "f(";
+            }
+            walk(calls + "0" + std::string(depth, ')') + ";", std::to_string(depth));
+        }
+    }
+
+    TEST_CASE("ParserDiagnosticsTest")
+    {
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString("let = 5;\nlet x 10;\nlet y = 3;\nif (y) { let = 1; y; } z;") };
+        interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+
+        // Each broken let is reported once, the parser picks up again after its ";"
+        const std::vector<Diagnostic>& diagnostics{ parser.GetDiagnostics().GetDiagnostics() };
+        REQUIRE(diagnostics.size() == 3);
+        REQUIRE(diagnostics[0].mCode == DiagnosticCode::UNEXPECTED_TOKEN);
+        REQUIRE(diagnostics[0].mExpected == TokenType::IDENT);
+        REQUIRE(diagnostics[0].mActual == TokenType::ASSIGN);
+        REQUIRE(diagnostics[0].mTokenIndex == 1);
+        REQUIRE(diagnostics[1].mExpected == TokenType::ASSIGN);
+        REQUIRE(diagnostics[1].mActual == TokenType::INT);
+        REQUIRE(diagnostics[1].mTokenIndex == 6);
+        REQUIRE(diagnostics[2].mExpected == TokenType::IDENT);
+        REQUIRE(diagnostics[2].mTokenIndex == 19);
+
+        REQUIRE(Diagnostics::Format(diagnostics[0], *source) == "line -> 0 character range -> (4,4) expected next token to be -> IDENTIFIER , actual type -> ASSIGN");
+        REQUIRE(Diagnostics::Format(diagnostics[1], *source) == "line -> 1 character range -> (6,7) expected next token to be -> ASSIGN , actual type -> INT");
+
+        // let y = 3; if (y) { y; }; z;
+        REQUIRE(program->mStatements.size() == 3);
+        REQUIRE(program->mStatements[0]->mNodeType == ast::NodeType::LetStatement);
+        const auto ifStatement{ dynamic_cast<ast::ExpressionStatement*>(program->mStatements[1]) };
+        REQUIRE(ifStatement);
+        const auto ifExpression{ dynamic_cast<ast::IfExpression*>(ifStatement->mValue) };
+        REQUIRE(ifExpression);
+        REQUIRE(ifExpression->mIfConditionBlock->mBlock->mStatements.size() == 1);
+        REQUIRE(program->mStatements[2]->TokenNode().mOffset == source->View().rfind('z'));
+
+        // No prefix parse function for "/", skipped up to the ";"
+        interpreter::Parser prefixParser{ std::make_unique<Lexer>("/ 5 5; 10;") };
+        interpreter::ProgramUniquePtr prefixProgram{ prefixParser.ParseProgram() };
+        REQUIRE(prefixParser.GetDiagnostics().Count() == 1);
+        REQUIRE(prefixParser.GetDiagnostics().GetDiagnostics()[0].mCode == DiagnosticCode::NO_PREFIX_PARSE_FUNCTION);
+        REQUIRE(prefixProgram->Log() == "10\n");
+
+        // A failed prefix parse isn't handed to the infix parse function of the next operator
+        interpreter::Parser infixParser{ std::make_unique<Lexer>("fn(x + 1; 7;") };
+        interpreter::ProgramUniquePtr infixProgram{ infixParser.ParseProgram() };
+        REQUIRE(infixParser.GetDiagnostics().Count() == 2);
+        REQUIRE(infixProgram->Log() == "7\n");
+
+        // The if's own error isn't taken for one its block has already recovered from, the whole if is dropped
+        interpreter::Parser nestedParser{ std::make_unique<Lexer>("if (/) { let = 1; 2 }; 9;") };
+        interpreter::ProgramUniquePtr nestedProgram{ nestedParser.ParseProgram() };
+        REQUIRE(nestedParser.GetDiagnostics().Count() == 2);
+        REQUIRE(nestedProgram->Log() == "9\n");
+
+        // Running into the end of the input while expecting a token is reported against the EOF
+        interpreter::Parser endParser{ std::make_unique<Lexer>("if (") };
+        interpreter::ProgramUniquePtr endProgram{ endParser.ParseProgram() };
+        REQUIRE(endParser.GetDiagnostics().Count() == 2);
+        REQUIRE(endParser.GetDiagnostics().GetDiagnostics()[1].mExpected == TokenType::RPAREN);
+        REQUIRE(endParser.GetDiagnostics().GetDiagnostics()[1].mActual == TokenType::ENDF);
+        REQUIRE(endProgram->mStatements.empty());
+    }
+
+    TEST_CASE("ParallelParserTest")
+    {
+        // Parser inputs glued together, with a few broken statements and a nested block in between
+        std::string corpus;
+        for (const char* fileName : { "letStatementTest.txt", "operatorPrecedenceTest.txt", "elseIfTest.txt", "functionParameterTest.txt", "callExpressionTest.txt" })
+        {
+            corpus += SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName)->View();
+            corpus += "\nlet = 1; if (x) { let y 2; x; } (1 + ; let z = fn(a) { a * 2; };\n";
+        }
+        std::string input;
+        for (int i = 0; i != 20; i++)
+        {
+            input += corpus;
+        }
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString(std::move(input)) };
+
+        interpreter::Parser sequentialParser{ std::make_unique<Lexer>(source) };
+        const interpreter::ProgramUniquePtr sequential{ sequentialParser.ParseProgram() };
+        const std::vector<Diagnostic>& expectedDiagnostics{ sequentialParser.GetDiagnostics().GetDiagnostics() };
+        REQUIRE(!expectedDiagnostics.empty());
+
+        for (const size_t statementsPerTask : { 1, 2, 7, 64, 100000 })
+        {
+            INFO("statements per task: " << statementsPerTask);
+            interpreter::Parser parallelParser{ std::make_unique<Lexer>(source, LexerMode::PARALLEL, 4096) };
+            const interpreter::ProgramUniquePtr parallel{ parallelParser.ParseProgramParallel(statementsPerTask) };
+
+            REQUIRE(parallel->mStatements.size() == sequential->mStatements.size());
+            REQUIRE(parallel->Log() == sequential->Log());
+
+            const std::vector<Diagnostic>& diagnostics{ parallelParser.GetDiagnostics().GetDiagnostics() };
+            REQUIRE(diagnostics.size() == expectedDiagnostics.size());
+            for (size_t i = 0; i != diagnostics.size(); i++)
+            {
+                REQUIRE(diagnostics[i].mCode == expectedDiagnostics[i].mCode);
+                REQUIRE(diagnostics[i].mExpected == expectedDiagnostics[i].mExpected);
+                REQUIRE(diagnostics[i].mActual == expectedDiagnostics[i].mActual);
+                REQUIRE(diagnostics[i].mTokenIndex == expectedDiagnostics[i].mTokenIndex);
+                REQUIRE(diagnostics[i].mOffset == expectedDiagnostics[i].mOffset);
+            }
+        }
+
+        // Streaming lexers fall back to the sequential parser
+        interpreter::Parser streamParser{ std::make_unique<Lexer>(source, LexerMode::STREAM) };
+        REQUIRE(streamParser.ParseProgramParallel(1)->Log() == sequential->Log());
+    }
+
+    TEST_CASE("ParallelParserBenchmark", "[.][benchmark]")
+    {
+        // Generated programs: tens of thousands of top level bindings
+        std::string corpus;
+        for (int i = 0; i != 50000; i++)
+        {
+            corpus += "let value" + std::to_string(i) + " = fn(x, y) { if (x > y) { x * " + std::to_string(i) + " } else { y + " + std::to_string(i % 97) + " } };\n";
+        }
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString(std::move(corpus)) };
+        WARN("bytes: " << source->Size() << ", hardware threads: " << std::thread::hardware_concurrency());
+
+        BENCHMARK("Sequential")
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+            return parser.ParseProgram()->mStatements.size();
+        };
+
+        BENCHMARK("Parallel")
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+            return parser.ParseProgramParallel()->mStatements.size();
+        };
+    }
+
+    TEST_CASE("IncrementalParserTest")
+    {
+        std::string input;
+        for (const char* fileName : { "letStatementTest.txt", "operatorPrecedenceTest.txt", "elseIfTest.txt", "functionParameterTest.txt", "callExpressionTest.txt" })
+        {
+            input += SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName)->View();
+            input += "\nlet = 1; if (x) { let y 2; x; } (1 + ; let z = fn(a) { a * 2; };\n";
+        }
+
+        // Whatever the edits were, the result has to match a fresh parse of the edited source, token offsets included
+        const auto requireSameAsFullParse = [](IncrementalParser& incremental)
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(incremental.GetSource()) };
+            const interpreter::ProgramUniquePtr expected{ parser.ParseProgram() };
+            ast::Program& program{ incremental.GetProgram() };
+            REQUIRE(program.mStatements.size() == expected->mStatements.size());
+            REQUIRE(program.Log() == expected->Log());
+
+            const ast::FlatProgram flat{ ast::FlatProgram::FromProgram(program) };
+            const ast::FlatProgram expectedFlat{ ast::FlatProgram::FromProgram(*expected) };
+            REQUIRE(flat.NodeCount() == expectedFlat.NodeCount());
+            for (ast::NodeIndex node = 0; node != flat.NodeCount(); node++)
+            {
+                REQUIRE(flat.GetNode(node).mKind == expectedFlat.GetNode(node).mKind);
+                REQUIRE(flat.GetNode(node).mOffset == expectedFlat.GetNode(node).mOffset);
+                REQUIRE(flat.Text(node) == expectedFlat.Text(node));
+            }
+
+            const std::vector<Diagnostic> diagnostics{ incremental.GetDiagnostics().GetDiagnostics() };
+            const std::vector<Diagnostic>& expectedDiagnostics{ parser.GetDiagnostics().GetDiagnostics() };
+            REQUIRE(diagnostics.size() == expectedDiagnostics.size());
+            for (size_t i = 0; i != diagnostics.size(); i++)
+            {
+                REQUIRE(diagnostics[i].mCode == expectedDiagnostics[i].mCode);
+                REQUIRE(diagnostics[i].mActual == expectedDiagnostics[i].mActual);
+                REQUIRE(diagnostics[i].mTokenIndex == expectedDiagnostics[i].mTokenIndex);
+                REQUIRE(diagnostics[i].mOffset == expectedDiagnostics[i].mOffset);
+            }
+        };
+
+        IncrementalParser incremental{ SourceBuffer::FromString(input) };
+        requireSameAsFullParse(incremental);
+
+        SECTION("Local edits only reparse their statement")
+        {
+            const size_t ranges{ incremental.RangeCount() };
+            const size_t letZ{ input.find("let z") };
+            incremental.Edit(letZ + 4, 1, "zz");
+            REQUIRE(incremental.LastReparsedRanges() == 1);
+            incremental.Edit(letZ, 0, "let w = 3 * 4;");
+            REQUIRE(incremental.LastReparsedRanges() == 2);
+            REQUIRE(incremental.RangeCount() == ranges + 1);
+            requireSameAsFullParse(incremental);
+
+            // An open brace swallows everything after it, closing it again splits the ranges back up
+            incremental.Edit(letZ, 0, "{");
+            requireSameAsFullParse(incremental);
+            REQUIRE(incremental.RangeCount() < ranges);
+            incremental.Edit(letZ, 1, "");
+            requireSameAsFullParse(incremental);
+            REQUIRE(incremental.RangeCount() == ranges + 1);
+
+            // Removing a ";" joins two statements, text after an unterminated last statement continues it
+            incremental.Edit(incremental.GetSource()->View().find(';'), 1, "");
+            requireSameAsFullParse(incremental);
+            incremental.Edit(incremental.GetSource()->Size(), 0, "let tail = 1");
+            incremental.Edit(incremental.GetSource()->Size(), 0, " + 2");
+            requireSameAsFullParse(incremental);
+
+            incremental.Edit(0, incremental.GetSource()->Size(), "\n");
+            requireSameAsFullParse(incremental);
+            REQUIRE(incremental.RangeCount() == 0);
+        }
+
+        SECTION("Random edits")
+        {
+            const std::array<std::string_view, 14> snippets{ "let a = 1;", ";", "{", "}", "(", ")", "x", " ", "\n", "fn(a, b) { a + b }", "if (x) { y } else if (z) { 1 } else { 2 };", "+ 2", "let", "else" };
+            uint64_t state{ 12345 };
+            const auto next = [&state](uint64_t bound) { state = state * 6364136223846793005ull + 1442695040888963407ull; return (state >> 33) % bound; };
+            for (int i = 0; i != 300; i++)
+            {
+                const size_t size{ incremental.GetSource()->Size() };
+                const size_t offset{ next(size + 1) };
+                const size_t removed{ std::min<size_t>(next(6), size - offset) };
+                const std::string_view inserted{ next(4) == 0 ? std::string_view{} : snippets[next(snippets.size())] };
+                INFO("edit " << i << ": " << offset << ", " << removed << ", \"" << inserted << "\"");
+                incremental.Edit(offset, removed, inserted);
+                requireSameAsFullParse(incremental);
+            }
+        }
+    }
+
+    TEST_CASE("IncrementalParserBenchmark", "[.][benchmark]")
+    {
+        std::string corpus;
+        for (int i = 0; i != 100000; i++)
+        {
+            corpus += "let value" + std::to_string(i) + " = fn(x, y) { if (x > y) { x * " + std::to_string(i) + " } else { y + 1 } };\n";
+        }
+        const size_t middle{ corpus.find("let value50000") };
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString(std::move(corpus)) };
+        IncrementalParser incremental{ source };
+
+        BENCHMARK("Full parse")
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+            return parser.ParseProgram()->mStatements.size();
+        };
+
+        BENCHMARK("Type and delete a character")
+        {
+            incremental.Edit(middle + 4, 0, "a");
+            incremental.Edit(middle + 4, 1, "");
+            return incremental.LastReparsedRanges();
+        };
+
+        // Everything after the insertion has moved by then
+        BENCHMARK("Insert a character and get the program")
+        {
+            incremental.Edit(middle + 4, 0, "a");
+            const size_t statements{ incremental.GetProgram().mStatements.size() };
+            incremental.Edit(middle + 4, 1, "");
+            return statements;
+        };
+    }
+
+    TEST_CASE("ProgramArenaTest")
+    {
+        ProgramArena arena{ 256 };
+        const auto byte{ static_cast<std::byte*>(arena.Allocate(1, 1)) };
+        const auto aligned{ arena.Allocate(sizeof(uint64_t), alignof(uint64_t)) };
+        REQUIRE(reinterpret_cast<uintptr_t>(aligned) % alignof(uint64_t) == 0);
+        REQUIRE(static_cast<std::byte*>(aligned) > byte);
+
+        // Bigger than a block, gets a block of its own
+        REQUIRE(arena.Allocate(1024, 16));
+        REQUIRE(arena.BlockCount() == 2);
+        REQUIRE(arena.BytesReserved() >= 256 + 1024);
+
+        arena.Reset();
+        REQUIRE(arena.BytesAllocated() == 0);
+        REQUIRE(arena.Allocate(1, 1) == byte);
+
+        // A recycled arena builds the same tree without growing
+        const auto parse = [](std::string_view text, ProgramArenaUniquePtr recycled)
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::string{ text })) };
+            return parser.ParseProgram(std::move(recycled));
+        };
+
+        const std::string_view text{ "let add = fn(x, y) { x + y; }; if (add(1, 2 * 3) > 4) { true } else { false };" };
+        interpreter::ProgramUniquePtr program{ parse(text, nullptr) };
+        REQUIRE(program->mStatements.size() == 2);
+        const std::string log{ program->Log() };
+        const size_t blockCount{ program->mArena->BlockCount() };
+        const size_t bytesAllocated{ program->mArena->BytesAllocated() };
+        REQUIRE(bytesAllocated > 0);
+
+        ProgramArenaUniquePtr recycled{ program->RecycleArena() };
+        REQUIRE(recycled);
+        REQUIRE(recycled->BytesAllocated() == 0);
+        REQUIRE(program->mStatements.empty());
+
+        program = parse(text, std::move(recycled));
+        REQUIRE(program->Log() == log);
+        REQUIRE(program->mArena->BlockCount() == blockCount);
+        REQUIRE(program->mArena->BytesAllocated() == bytesAllocated);
+    }
+
+    TEST_CASE("FlatProgramTest")
+    {
+        for (const char* fileName : { "letStatementTest.txt", "operatorPrecedenceTest.txt", "elseIfTest.txt", "ifElseExpressionTest.txt",
+            "functionParameterTest.txt", "callExpressionTest.txt", "prefixOperatorExpressionStatementsTest.txt" })
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName)) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            const ast::FlatProgram flatProgram{ ast::FlatProgram::FromProgram(*program) };
+
+            REQUIRE(flatProgram.GetStatements().size() == program->mStatements.size());
+            REQUIRE(flatProgram.Log() == program->Log());
+            REQUIRE(flatProgram.MemoryUsage() < program->mArena->BytesAllocated());
+
+            // Post-order: children always come before their parent
+            for (ast::NodeIndex node = 0; node != flatProgram.NodeCount(); node++)
+            {
+                for (const ast::NodeIndex child : flatProgram.GetChildren(node))
+                {
+                    REQUIRE((child == ast::sNoNode || child < node));
+                }
+            }
+        }
+
+        interpreter::Parser parser{ std::make_unique<Lexer>("let x = 5; add(x, 10); !true;") };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        const ast::FlatProgram flatProgram{ ast::FlatProgram::FromProgram(*program) };
+        REQUIRE(flatProgram.NodeCount() == 11);
+        const ast::NodeIndex letStatement{ flatProgram.GetStatements()[0] };
+        REQUIRE(flatProgram.GetNode(letStatement).mKind == ast::FlatNodeKind::LetStatement);
+        const auto letChildren{ flatProgram.GetChildren(letStatement) };
+        REQUIRE(letChildren.size() == 2);
+        REQUIRE(flatProgram.Text(letChildren[0]) == "x");
+        REQUIRE(flatProgram.GetSymbol(letChildren[0]) == program->mSymbols->Find("x"));
+        REQUIRE(flatProgram.GetNumber(letChildren[1]) == 5);
+
+        const ast::NodeIndex callExpression{ flatProgram.GetChildren(flatProgram.GetStatements()[1])[0] };
+        REQUIRE(flatProgram.GetNode(callExpression).mKind == ast::FlatNodeKind::CallExpression);
+        REQUIRE(flatProgram.GetChildren(callExpression).size() == 3);
+        const Token token{ flatProgram.GetToken(flatProgram.GetChildren(callExpression)[2]) };
+        REQUIRE(token.mType == TokenType::INT);
+        REQUIRE(std::get<Number>(token.mLiteral) == 10);
+        REQUIRE(token.mOffset == 18);
+
+        const ast::NodeIndex bang{ flatProgram.GetChildren(flatProgram.GetStatements()[2])[0] };
+        REQUIRE(flatProgram.GetNode(bang).mTokenType == TokenType::BANG);
+        REQUIRE(flatProgram.GetBool(flatProgram.GetChildren(bang)[0]));
+    }
+
+    TEST_CASE("FlatProgramEvaluateTest")
+    {
+        // Evaluating the flat program has to agree with evaluating the tree, statement by statement
+        for (const char* fileName : { "evalIntegerExpressionTest.txt", "evalBoolExpressionTest.txt", "evalMinusPrefixExpressionTest.txt", "evalBangPrefixExpressionTest.txt" })
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName)) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(ast::FlatProgram::FromProgram(*program)) };
+            const std::vector<ObjectSharedPtr> expected{ Evaluator{}.Evaluate(*program) };
+
+            REQUIRE(results.size() == expected.size());
+            for (size_t i = 0; i != results.size(); i++)
+            {
+                REQUIRE(results[i]);
+                REQUIRE(expected[i]);
+                REQUIRE(results[i]->Inspect() == expected[i]->Inspect());
+            }
+        }
+
+        // Expressions left out of the tree are left out of the flat program as well, both evaluate them to null
+        interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString("1; -2; 3 + 4;")) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        const auto Value = [&program](size_t statement) -> ast::Expression*& { return static_cast<ast::ExpressionStatement*>(program->mStatements[statement])->mValue; };
+        static_cast<ast::PrefixExpression*>(Value(1))->mRightSideValue = nullptr;
+        static_cast<ast::InfixExpression*>(Value(2))->mRightExpression = nullptr;
+        Value(0) = nullptr;
+        const ast::FlatProgram flatProgram{ ast::FlatProgram::FromProgram(*program) };
+        REQUIRE(flatProgram.GetChildren(flatProgram.GetStatements()[0])[0] == ast::sNoNode);
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(flatProgram) };
+        const std::vector<ObjectSharedPtr> expected{ Evaluator{}.Evaluate(*program) };
+        REQUIRE(results.size() == 3);
+        for (size_t i = 0; i != results.size(); i++)
+        {
+            REQUIRE(results[i]->Inspect() == "nullptr");
+            REQUIRE(expected[i]->Inspect() == "nullptr");
+        }
+    }
+
+    TEST_CASE("FlatProgramSerializationTest")
+    {
+        for (const char* fileName : { "letStatementTest.txt", "operatorPrecedenceTest.txt", "elseIfTest.txt", "ifElseExpressionTest.txt",
+            "functionParameterTest.txt", "callExpressionTest.txt", "evalIntegerExpressionTest.txt" })
+        {
+            const SourceBufferSharedPtr source{ SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName) };
+            interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            const ast::FlatProgram flatProgram{ ast::FlatProgram::FromProgram(*program) };
+            const std::string bytes{ flatProgram.Serialize() };
+            REQUIRE(bytes.size() < flatProgram.MemoryUsage());
+
+            const std::optional<ast::FlatProgram> loaded{ ast::FlatProgram::Deserialize(bytes, source) };
+            REQUIRE(loaded);
+            REQUIRE(loaded->NodeCount() == flatProgram.NodeCount());
+            REQUIRE(loaded->GetStatements() == flatProgram.GetStatements());
+            REQUIRE(loaded->Log() == program->Log());
+            REQUIRE(loaded->ToProgram()->Log() == program->Log());
+            for (ast::NodeIndex node = 0; node != flatProgram.NodeCount(); node++)
+            {
+                const Token expected{ flatProgram.GetToken(node) };
+                const Token actual{ loaded->GetToken(node) };
+                REQUIRE(actual.mType == expected.mType);
+                REQUIRE(actual.mOffset == expected.mOffset);
+                REQUIRE(actual.mLength == expected.mLength);
+                REQUIRE(actual.mLiteral == expected.mLiteral);
+            }
+        }
+
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString("let add = fn(x, y) { x + y; }; if (add(1, -2) < 4) { true } else { !false };") };
+        interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        const std::string bytes{ ast::FlatProgram::FromProgram(*program).Serialize() };
+        REQUIRE(ast::FlatProgram::Deserialize(bytes, source)->GetSymbols()->Find("add") == program->mSymbols->Find("add"));
+
+        // Only the text it was parsed from will do
+        REQUIRE_FALSE(ast::FlatProgram::Deserialize(bytes, SourceBuffer::FromString(std::string{ source->View() } + " ")));
+        // Even one whose hash and size match, the hash sits right after the magic and the two one byte versions
+        const SourceBufferSharedPtr renamed{ SourceBuffer::FromString(std::string{ source->View() }.replace(4, 3, "sum")) };
+        std::string forged{ bytes };
+        for (size_t i = 0; i != sizeof(uint64_t); i++)
+        {
+            forged[6 + i] = static_cast<char>(renamed->ContentHash() >> (i * 8));
+        }
+        REQUIRE_FALSE(ast::FlatProgram::Deserialize(forged, renamed));
+        // Nor does a tree rewritten under other rules
+        REQUIRE(ast::FlatProgram::Deserialize(ast::FlatProgram::FromProgram(*program).Serialize(ast::ConstantFolder::sVersion), source, ast::ConstantFolder::sVersion));
+        REQUIRE_FALSE(ast::FlatProgram::Deserialize(ast::FlatProgram::FromProgram(*program).Serialize(ast::ConstantFolder::sVersion), source, ast::ConstantFolder::sVersion + 1));
+        // Damaged files are turned down instead of handing out a broken tree
+        for (size_t size = 0; size != bytes.size(); size++)
+        {
+            REQUIRE_FALSE(ast::FlatProgram::Deserialize(std::string_view{ bytes }.substr(0, size), source));
+        }
+        // A damaged byte either gets the file turned down or still reads back as a tree that every walk agrees on
+        for (size_t position = 0; position != bytes.size(); position++)
+        {
+            for (const uint8_t mask : { 0x01, 0x02, 0x80, 0xFF })
+            {
+                std::string damaged{ bytes };
+                damaged[position] = static_cast<char>(damaged[position] ^ mask);
+                if (const std::optional<ast::FlatProgram> loaded{ ast::FlatProgram::Deserialize(damaged, source) })
+                {
+                    const interpreter::ProgramUniquePtr tree{ loaded->ToProgram() };
+                    REQUIRE(tree->Log() == loaded->Log());
+                    REQUIRE(ast::FlatProgram::FromProgram(*tree).Log() == loaded->Log());
+                }
+            }
+        }
+    }
+
+    TEST_CASE("ProgramCacheTest")
+    {
+        const std::filesystem::path directory{ std::filesystem::temp_directory_path() / "InterpreterProgramCacheTest" };
+        std::filesystem::remove_all(directory);
+        const ProgramCache cache{ directory };
+
+        const SourceBufferSharedPtr source{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/evalIntegerExpressionTest.txt") };
+        REQUIRE_FALSE(cache.Find(source));
+
+        interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        REQUIRE(cache.Store(ast::FlatProgram::FromProgram(*program)));
+        REQUIRE(std::filesystem::exists(cache.GetPath(*source)));
+
+        // A second run of the same text, read from a different buffer, gets the program without parsing
+        const SourceBufferSharedPtr again{ SourceBuffer::FromString(std::string{ source->View() }) };
+        const std::optional<ast::FlatProgram> cached{ cache.Find(again) };
+        REQUIRE(cached);
+        REQUIRE(cached->GetSource() == again);
+        REQUIRE(cached->Log() == program->Log());
+
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*cached) };
+        const std::vector<ObjectSharedPtr> expected{ Evaluator{}.Evaluate(*program) };
+        REQUIRE(results.size() == expected.size());
+        for (size_t i = 0; i != results.size(); i++)
+        {
+            REQUIRE(results[i]);
+            REQUIRE(results[i]->Inspect() == expected[i]->Inspect());
+        }
+
+        // Any change to the text misses
+        REQUIRE_FALSE(cache.Find(SourceBuffer::FromString(std::string{ source->View() } + "\n1;")));
+        std::filesystem::remove_all(directory);
+    }
+
+    TEST_CASE("OutputBufferTest")
+    {
+        OutputBuffer out;
+        out.Append(std::numeric_limits<Number>::min()).Append(' ').Append(Number{ 0 }).Append(' ').Append(std::numeric_limits<Number>::max());
+        REQUIRE(out.View() == "-9223372036854775808 0 9223372036854775807");
+
+        // Logging statement after statement into one buffer gives the same text as logging the program
+        const SourceBufferSharedPtr source{ SourceBuffer::FromString("let add = fn(x, y) { x + y; }; if (add(1, -2) < 4) { true } else if (x) { !false } else { 10 }; return add(a, b(c));") };
+        interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+        out.Clear();
+        for (const auto& statement : program->mStatements)
+        {
+            statement->Log(out);
+            out.Append('\n');
+        }
+        REQUIRE(out.View() == program->Log());
+        REQUIRE(program->Log() == ast::FlatProgram::FromProgram(*program).Log());
+
+        out.Clear();
+        IntegerType{ -42 }.Inspect(out);
+        out.Append(' ');
+        BoolType{ true }.Inspect(out);
+        out.Append(' ');
+        NullType{}.Inspect(out);
+        REQUIRE(out.View() == "-42 true nullptr");
+        REQUIRE(IntegerType{ 7 }.Inspect() == "7");
+        REQUIRE(out.Release() == "-42 true nullptr");
+        REQUIRE(out.Empty());
+    }
+
+    TEST_CASE("AstLogBenchmark", "[.][benchmark]")
+    {
+        std::string corpus;
+        for (int i = 0; i != 50000; i++)
+        {
+            corpus += "let value" + std::to_string(i) + " = fn(x, y) { if (x > y) { x * (" + std::to_string(i) + " + -y) } else { f(y, " + std::to_string(i % 97) + ") } };\n";
+        }
+        interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(corpus))) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+
+        BENCHMARK("String per statement")
+        {
+            size_t size{ 0 };
+            for (const auto& statement : program->mStatements)
+            {
+                size += statement->Log().size();
+            }
+            return size;
+        };
+
+        OutputBuffer out;
+        BENCHMARK("One buffer")
+        {
+            out.Clear();
+            program->Log(out);
+            return out.Size();
+        };
+    }
+
+    TEST_CASE("ConstantFolderTest")
+    {
+        const auto fold = [](std::string text, size_t& folded, size_t& pruned)
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(text))) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            REQUIRE(parser.GetDiagnostics().Count() == 0);
+            ast::ConstantFolder folder{ *program };
+            folder.Fold();
+            folded = folder.FoldedExpressions();
+            pruned = folder.PrunedBranches();
+            return program;
+        };
+        size_t folded{ 0 };
+        size_t pruned{ 0 };
+
+        SECTION("Arithmetic")
+        {
+            REQUIRE(fold("1 + 2 * 3; -(5 - 10); !(1 + 1); !!true; let x = 2 * (3 + 4);", folded, pruned)->Log() == "7\n5\nfalse\ntrue\nlet x = 14;\n");
+            REQUIRE(folded == 10);
+
+            // Only what the evaluator would compute the same way
+            REQUIRE(fold("9223372036854775807 + 1; 10 / (5 - 5); -9223372036854775807 - 2; 4611686018427387904 * 2; x + 1 * 2; -true; true < false;", folded, pruned)->Log() ==
+                "(9223372036854775807 + 1)\n(10 / 0)\n(-9223372036854775807 - 2)\n(4611686018427387904 * 2)\n(x + 2)\n(-true)\n(true < false)\n");
+            REQUIRE(folded == 3);
+
+            // Comparisons fold to bools
+            REQUIRE(fold("1 < 2; 3 > 4 + 1; 2 * 3 == 6; 1 != 1; true == !false; true != true;", folded, pruned)->Log() == "true\nfalse\ntrue\nfalse\ntrue\nfalse\n");
+            REQUIRE(folded == 9);
+
+            // The literal spans the text it was folded from
+            interpreter::ProgramUniquePtr program{ fold("a; 12 * (3 + 4);", folded, pruned) };
+            const Token& token{ static_cast<ast::ExpressionStatement*>(program->mStatements[1])->mValue->TokenNode() };
+            REQUIRE(program->mSource->View().substr(token.mOffset, token.mLength) == "12 * (3 + 4)");
+            const auto foldedText = [&](std::string_view text)
+            {
+                interpreter::ProgramUniquePtr program{ fold(std::string{ text }, folded, pruned) };
+                const Token& token{ static_cast<ast::ExpressionStatement*>(program->mStatements[0])->mValue->TokenNode() };
+                return std::string{ program->mSource->View().substr(token.mOffset, token.mLength) };
+            };
+            REQUIRE(foldedText("((1 + 2)) * 3;") == "((1 + 2)) * 3");
+            REQUIRE(foldedText("-( 5 );") == "-( 5 )");
+            REQUIRE(foldedText("(1 + (2 * 3));") == "1 + (2 * 3)");
+        }
+
+        SECTION("Branches")
+        {
+            const auto ifExpression = [](const interpreter::ProgramUniquePtr& program)
+            {
+                const auto expression{ dynamic_cast<ast::IfExpression*>(static_cast<ast::ExpressionStatement*>(program->mStatements[0])->mValue) };
+                REQUIRE(expression);
+                REQUIRE(expression->mIfConditionBlock->mToken == expression->mToken);
+                return expression;
+            };
+
+            interpreter::ProgramUniquePtr program{ fold("if (x < 0 + 0) { 1 } else { 2 };", folded, pruned) };
+            REQUIRE(program->Log() == "if(x < 0){ 1 }  else { 2 }\n");
+            REQUIRE(pruned == 0);
+
+            program = fold("if (1 < 0 + 0) { 1 } else { 2 };", folded, pruned);
+            REQUIRE(program->Log() == "iftrue{ 2 } \n");
+            REQUIRE(pruned == 1);
+
+            program = fold("if (!false) { 1 } else if (x) { 2 } else { 3 };", folded, pruned);
+            REQUIRE(program->Log() == "iftrue{ 1 } \n");
+            REQUIRE(pruned == 2);
+
+            program = fold("if (x) { 1 } else if (false) { 2 } else if (1) { 3 } else if (y) { 4 } else { 5 };", folded, pruned);
+            REQUIRE(ifExpression(program)->mElseIfBlocks.empty());
+            REQUIRE(program->Log() == "ifx{ 1 }  else { 3 }\n");
+            REQUIRE(pruned == 3);
+
+            program = fold("if (false) { 1 } else if (x) { 2 } else { 3 };", folded, pruned);
+            REQUIRE(program->Log() == "ifx{ 2 }  else { 3 }\n");
+            REQUIRE(pruned == 1);
+
+            program = fold("if (!true) { 1 } else { 2 };", folded, pruned);
+            REQUIRE(ifExpression(program)->mAlternative == nullptr);
+            REQUIRE(program->Log() == "iftrue{ 2 } \n");
+            REQUIRE(pruned == 1);
+
+            program = fold("if (false) { 1 } else if (false) { 2 };", folded, pruned);
+            REQUIRE(program->Log() == "iffalse{  } \n");
+            REQUIRE(pruned == 1);
+
+            // Nested ifs and function bodies are folded too
+            program = fold("let f = fn(a) { if (true) { a * (2 + 2) } else { 0 } };", folded, pruned);
+            REQUIRE(program->Log() == "let f = fn(a) { iftrue{ (a * 4) }  };\n");
+        }
+
+        SECTION("Evaluation")
+        {
+            // Folding doesn't change what the statements evaluate to
+            for (const char* fileName : { "evalIntegerExpressionTest.txt", "evalBoolExpressionTest.txt", "evalMinusPrefixExpressionTest.txt", "evalBangPrefixExpressionTest.txt" })
+            {
+                const SourceBufferSharedPtr source{ SourceBuffer::FromFile(std::string{ "E:/dev/Interpreter/tests/input/" } + fileName) };
+                interpreter::Parser parser{ std::make_unique<Lexer>(source) };
+                interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+                interpreter::Parser foldedParser{ std::make_unique<Lexer>(source) };
+                interpreter::ProgramUniquePtr foldedProgram{ foldedParser.ParseProgram() };
+                ast::ConstantFolder{ *foldedProgram }.Fold();
+
+                const std::vector<ObjectSharedPtr> expected{ Evaluator{}.Evaluate(*program) };
+                const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*foldedProgram) };
+                REQUIRE(results.size() == expected.size());
+                for (size_t i = 0; i != expected.size(); i++)
+                {
+                    REQUIRE(results[i]->Inspect() == expected[i]->Inspect());
+                }
+            }
+        }
     }
 
     TEST_CASE("LetStatementTest")
@@ -701,7 +1927,7 @@ namespace interpreter
         // let y = true; y = true
         // let foobar = y; foobar = y
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/letStatementTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/letStatementTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
@@ -712,22 +1938,23 @@ namespace interpreter
 
         for (int i = 0; i != 3; i++)
         {
-            ast::Statement* statement{ program->mStatements[i].get() };
+            ast::Statement* statement{ program->mStatements[i] };
             auto letStatement{ dynamic_cast<ast::LetStatement*>(statement) };
             REQUIRE(letStatement);
 
-            REQUIRE(letStatement->mToken.mType == TokenType::LET);
+            REQUIRE(letStatement->TokenNode().mType == TokenType::LET);
 
             REQUIRE(letStatement->mIdentifier);
-            test::TestPrimitiveExpression(letStatement->mIdentifier.get(), identifiers[i]);
+            test::TestPrimitiveExpression(letStatement->mIdentifier, identifiers[i]);
 
             REQUIRE(letStatement->mValue);
-            test::TestPrimitiveExpression(letStatement->mValue.get(), values[i]);
+            test::TestPrimitiveExpression(letStatement->mValue, values[i]);
         }
     }
 
     bool TestIntegerObject(ObjectSharedPtr object, Number expectedValue)
     {
+        REQUIRE(object->Type() == ObjectType::Integer);
         const auto objectRawPtr{ object.get() };
         const auto integerPtr{ dynamic_cast<IntegerType*>(objectRawPtr) };
         REQUIRE(integerPtr);
@@ -753,27 +1980,24 @@ namespace interpreter
         //3 * (3 * 3) + 10;
         //(5 + 10 * 2 + 15 / 3) * 2 + -10
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/evalIntegerExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/evalIntegerExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
-        const auto testEval = [](ast::Node* statement) -> ObjectSharedPtr
-        {
-            return Parser::Evaluate(statement);
-        };
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*program) };
 
         std::vector<int> expectedVal{ 5, 101, -3, -104 , 10 , 32, 0, 20, 25, 0, 60, 30, 37,  37, 50};
         for (int i = 0; i != expectedVal.size(); i++)
         {
-            const auto& statement{ program->mStatements[i] };
-            const auto val{ testEval(statement.get()) };
+            const auto& val{ results[i] };
             TestIntegerObject(val, expectedVal[i]);
         }
     }
 
     bool TestBoolObject(ObjectSharedPtr object, bool expectedValue)
     {
+        REQUIRE(object->Type() == ObjectType::Boolean);
         const auto objectRawPtr{ object.get() };
         const auto boolPtr{ dynamic_cast<BoolType*>(objectRawPtr) };
         REQUIRE(boolPtr);
@@ -783,42 +2007,34 @@ namespace interpreter
 
     TEST_CASE("EvalBoolExpressionTest")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/evalBoolExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/evalBoolExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
-        const auto testEval = [](ast::Node* statement) -> ObjectSharedPtr
-        {
-            return Parser::Evaluate(statement);
-        };
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*program) };
 
         std::vector<bool> expectedVal{ false, true };
         for (int i = 0; i != 2; i++)
         {
-            const auto& statement{ program->mStatements[i] };
-            const auto val{ testEval(statement.get()) };
+            const auto& val{ results[i] };
             TestBoolObject(val, expectedVal[i]);
         }
     }
 
     TEST_CASE("EvalPrefixMinusExpressionTest")
     {
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/evalMinusPrefixExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/evalMinusPrefixExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
-        const auto testEval = [](ast::Node* statement) -> ObjectSharedPtr
-        {
-            return Parser::Evaluate(statement);
-        };
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*program) };
 
         std::vector<Number> expectedVal{ 5,10,-5,-10 , 9223372036854775807, -9223372036854775807 };
         for (int i = 0; i != expectedVal.size(); i++)
         {
-            const auto& statement{ program->mStatements[i] };
-            const auto val{ testEval(statement.get()) };
+            const auto& val{ results[i] };
             TestIntegerObject(val, expectedVal[i]);
         }
     }
@@ -835,23 +2051,167 @@ namespace interpreter
         //!true;
         //!false;
 
-        std::string parserInput{ interpreter::utility::ReadTextFile("E:/dev/Interpreter/tests/input/evalBangPrefixExpressionTest.txt") };
+        SourceBufferSharedPtr parserInput{ SourceBuffer::FromFile("E:/dev/Interpreter/tests/input/evalBangPrefixExpressionTest.txt") };
         interpreter::LexerUniquePtr lexer{ std::make_unique<Lexer>(parserInput) };
         interpreter::Parser parser{ std::move(lexer) };
         interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
 
-        const auto testEval = [](ast::Node* statement) -> ObjectSharedPtr
-        {
-            return Parser::Evaluate(statement);
-        };
+        const std::vector<ObjectSharedPtr> results{ Evaluator{}.Evaluate(*program) };
 
         std::vector<bool> expectedVal{ true, false, false, true, false, true, false, false, true };
         for (int i = 0; i != expectedVal.size(); i++)
         {
-            const auto& statement{ program->mStatements[i] };
-            const auto val{ testEval(statement.get()) };
+            const auto& val{ results[i] };
             TestBoolObject(val, expectedVal[i]);
         }
     }
 
+
+    TEST_CASE("EvaluatorTest")
+    {
+        // Function values point into the tree that defined them, the programs are kept until the evaluator is gone
+        std::vector<interpreter::ProgramUniquePtr> programs;
+        Evaluator evaluator;
+        const auto evaluate = [&programs, &evaluator](std::string text)
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(text))) };
+            programs.push_back(parser.ParseProgram());
+            REQUIRE(parser.GetDiagnostics().Count() == 0);
+            OutputBuffer out;
+            for (const ObjectSharedPtr& value : evaluator.Evaluate(*programs.back()))
+            {
+                value ? value->Inspect(out) : void(out.Append("-"));
+                out.Append(' ');
+            }
+            return std::string{ out.View() };
+        };
+
+        SECTION("Let")
+        {
+            REQUIRE(evaluate("let a = 5; a; let b = a * 2; b + a; let a = b; a;") == "- 5 - 15 - 10 ");
+            // Lines of the REPL are separate programs with their own symbol tables
+            REQUIRE(evaluate("let c = 1; b + c; a;") == "- 11 10 ");
+            // Negating a variable leaves it alone
+            REQUIRE(evaluate("-a; a;") == "-10 10 ");
+            REQUIRE(evaluate("missing;") == "nullptr ");
+        }
+
+        SECTION("Comparisons")
+        {
+            REQUIRE(evaluate("1 < 2; 1 > 2; 1 == 1; 1 != 1; true == false; true != false; true < false;") == "true false true false false true nullptr ");
+            REQUIRE(evaluate("10 / 0; 1 / 2;") == "nullptr 0 ");
+            // Overflow is an error, not a wrapped around value
+            REQUIRE(evaluate("9223372036854775807 + 1; 4611686018427387904 * 2; -9223372036854775807 - 2; 4611686018427387904 * -2;") == "nullptr nullptr nullptr -9223372036854775808 ");
+            REQUIRE(evaluate("let smallest = -9223372036854775807 - 1; -smallest; -(smallest + 1);") == "- nullptr 9223372036854775807 ");
+        }
+
+        SECTION("If")
+        {
+            REQUIRE(evaluate("if (true) { 10 }; if (false) { 10 }; if (1) { 10 }; if (1 > 2) { 10 } else { 20 };") == "10 nullptr 10 20 ");
+            REQUIRE(evaluate("let x = 3; if (x < 2) { 1 } else if (x < 4) { 2 } else if (x < 6) { 3 } else { 4 };") == "- 2 ");
+            REQUIRE(evaluate("if (true) { let y = 1; };") == "nullptr ");
+            // 0 is falsy like false and null, the same for conditions and "!"
+            REQUIRE(evaluate("if (0) { 10 } else { 20 }; if (-1) { 10 }; !0; !!5; if (missing) { 10 } else { 20 };") == "20 10 true true 20 ");
+        }
+
+        SECTION("Return")
+        {
+            REQUIRE(evaluate("return 10; 9;") == "10 ");
+            REQUIRE(evaluate("9; return 2 * 5; 9;") == "9 10 ");
+            REQUIRE(evaluate("if (10 > 1) { if (10 > 1) { return 10; } return 1; }; 9;") == "10 ");
+            REQUIRE(evaluate("let f = fn(x) { return x; x + 10; }; f(10); 9;") == "- 10 9 ");
+            REQUIRE(evaluate("let g = fn(x) { if (x > 0) { return 1; } return 0; }; g(5); g(-5);") == "- 1 0 ");
+        }
+
+        SECTION("Functions")
+        {
+            REQUIRE(evaluate("let identity = fn(x) { x; }; identity(5);") == "- 5 ");
+            REQUIRE(evaluate("let add = fn(x, y) { x + y; }; add(5 + 5, add(5, 5));") == "- 20 ");
+            REQUIRE(evaluate("fn(x) { x; }(5); fn() { 1 }();") == "5 1 ");
+            REQUIRE(evaluate("fn(x) { x * 2 };") == "fn(x) { (x * 2) } ");
+            REQUIRE(evaluate("let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(15);") == "- 610 ");
+            // Parameters shadow globals without changing them
+            REQUIRE(evaluate("let x = 1; let h = fn(x) { x * 10 }; h(2); x;") == "- - 20 1 ");
+            // A function defined on an earlier line is called with the symbols of its own program
+            REQUIRE(evaluate("add(identity(1), 2);") == "3 ");
+            REQUIRE(evaluate("add(1); 5(1);") == "nullptr nullptr ");
+        }
+
+        SECTION("Types")
+        {
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString("1; true; 1 + true; fn() { 1 };")) };
+            programs.push_back(parser.ParseProgram());
+            const std::vector<ObjectSharedPtr> results{ evaluator.Evaluate(*programs.back()) };
+            REQUIRE(results.size() == 4);
+            const std::vector<ObjectType> types{ ObjectType::Integer, ObjectType::Boolean, ObjectType::Null, ObjectType::Function };
+            const std::vector<std::string_view> names{ "int", "bool", "NULL", "fn" };
+            for (size_t i = 0; i != results.size(); i++)
+            {
+                REQUIRE(results[i]->Type() == types[i]);
+                REQUIRE(results[i]->TypeName() == names[i]);
+            }
+        }
+
+        SECTION("Closures")
+        {
+            REQUIRE(evaluate("let newAdder = fn(x) { fn(y) { x + y } }; let addTwo = newAdder(2); addTwo(3); newAdder(10)(1);") == "- - 5 11 ");
+            REQUIRE(evaluate("let counter = fn(x) { if (x > 100) { return x; } counter(x + 1) }; counter(0);") == "- 101 ");
+
+            // A function bound in a call's scope points back at it, the scope is cleared once the call is done with it. Then
+            // nothing holds on to the argument anymore.
+            std::weak_ptr<Object> argument;
+            {
+                interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString("let v = fn() { 0 }; v;")) };
+                programs.push_back(parser.ParseProgram());
+                argument = evaluator.Evaluate(*programs.back())[1];
+            }
+            REQUIRE(evaluate("let keep = fn(f) { let g = fn() { f }; g(); 1 }; keep(v); let v = 0;") == "- 1 - ");
+            REQUIRE(argument.expired());
+            // A closure over the scope keeps it
+            REQUIRE(evaluate("let make = fn(x) { let g = fn() { x }; fn() { g() } }; make(4)();") == "- 4 ");
+            // Until the Evaluator goes away, then what the scope binds is let go of as well
+            {
+                interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString("let v = fn() { 0 }; let make = fn(x) { let g = fn() { x }; fn() { g() } }; make(v)(); v;")) };
+                interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+                Evaluator closureEvaluator;
+                argument = closureEvaluator.Evaluate(*program).back();
+            }
+            REQUIRE(argument.expired());
+        }
+
+        SECTION("Flat programs")
+        {
+            // The flat form only holds expressions over literals, those evaluate the same as the tree
+            interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString("1 + 2 * 3; !(4 < 5); -(-7);")) };
+            interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+            const std::vector<ObjectSharedPtr> results{ evaluator.Evaluate(ast::FlatProgram::FromProgram(*program)) };
+            REQUIRE(results.size() == 3);
+            REQUIRE(results[0]->Inspect() == "7");
+            REQUIRE(results[1]->Inspect() == "false");
+            REQUIRE(results[2]->Inspect() == "7");
+        }
+    }
+
+    TEST_CASE("EvaluatorBenchmark", "[.][benchmark]")
+    {
+        std::string corpus;
+        for (int i = 0; i != 20000; i++)
+        {
+            corpus += "(" + std::to_string(i) + " + 5 * -3) * (2 - " + std::to_string(i % 13) + ") / 7 + !(" + std::to_string(i) + " * 0);\n";
+        }
+        interpreter::Parser parser{ std::make_unique<Lexer>(SourceBuffer::FromString(std::move(corpus))) };
+        interpreter::ProgramUniquePtr program{ parser.ParseProgram() };
+
+        BENCHMARK("Expressions")
+        {
+            return Evaluator{}.Evaluate(*program).size();
+        };
+
+        interpreter::Parser fibParser{ std::make_unique<Lexer>("let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(20);") };
+        interpreter::ProgramUniquePtr fibProgram{ fibParser.ParseProgram() };
+        BENCHMARK("Calls")
+        {
+            return Evaluator{}.Evaluate(*fibProgram).size();
+        };
+    }
 }